@@ -0,0 +1,60 @@
+#include "AllocationCounter.h"
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#ifdef CUTTER_ALLOCATION_COUNTER
+
+namespace {
+
+// Plain integer: no dynamic initialization, so it is usable from operator new on any thread at any time
+thread_local unsigned long long allocations = 0;
+
+void* countedAlloc(std::size_t size) {
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+bool AllocationCounter::enabled() { return true; }
+unsigned long long AllocationCounter::threadAllocations() { return allocations; }
+
+#else
+
+bool AllocationCounter::enabled() { return false; }
+unsigned long long AllocationCounter::threadAllocations() { return 0; }
+
+#endif
+
+void AllocationCheck::beginFrame() {
+    skip = false;
+    start = AllocationCounter::threadAllocations();
+}
+
+unsigned long long AllocationCheck::endFrame() {
+    unsigned long long made = AllocationCounter::threadAllocations() - start;
+    bool checked = frames++ >= warmup && !skip;
+    assert(!checked || made == 0);   // A buffer of the frame loop was (re)allocated after the warm-up
+    (void)checked;
+    return made;
+}
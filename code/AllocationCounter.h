@@ -0,0 +1,39 @@
+#pragma once
+
+// ------- ALLOCATION COUNTER ------- //
+// Debug builds replace the global operator new / delete with a version that counts the allocations of
+// every thread (define CUTTER_NO_ALLOCATION_COUNTER to keep the default allocator). The player loop uses
+// it to check that, once its buffers are sized, consuming a frame never touches the heap. Release builds
+// compile the counter out: count() is then always 0 and the check does nothing.
+//
+// Only operator new is counted. OpenCV allocates Mat data with its own malloc wrapper, but Mat headers
+// of new buffers (UMatData) and all std containers go through operator new, so a reallocated Mat shows up.
+
+#if !defined(NDEBUG) && !defined(CUTTER_NO_ALLOCATION_COUNTER)
+#define CUTTER_ALLOCATION_COUNTER 1
+#endif
+
+namespace AllocationCounter {
+    // False when compiled out
+    bool enabled();
+    // operator new calls of the calling thread since it started
+    unsigned long long threadAllocations();
+}
+
+// Steady-state allocation check of a per-frame loop on the calling thread. Frames before warmupFrames and
+// frames marked with skipFrame() (events such as a trackbar change or a growing cache) are not checked.
+class AllocationCheck {
+public:
+    explicit AllocationCheck(long long warmupFrames) : warmup(warmupFrames) {}
+
+    void beginFrame();
+    void skipFrame() { skip = true; }
+    // Allocations of the frame; debug builds assert that a checked frame made none
+    unsigned long long endFrame();
+
+private:
+    long long warmup;
+    long long frames = 0;
+    bool skip = false;
+    unsigned long long start = 0;
+};
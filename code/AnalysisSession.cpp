@@ -0,0 +1,549 @@
+#include "AnalysisSession.h"
+#include "ExportQueue.h"
+#include "FrameProcessing.h"
+#include "FrameSource.h"
+#include "MeasurementLog.h"
+#include "TaskPool.h"
+#include "Telemetry.h"
+#include "VideoChunks.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>             // For file output
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// True if another Mat (e.g. a queued click analysis) still references the buffer of m
+bool isShared(const Mat& m) {
+    return m.u && CV_XADD(&m.u->refcount, 0) > 1;
+}
+
+} // namespace
+
+string videoBaseName(const string& path) {
+    size_t lastSlash = path.find_last_of("/\\");
+    string fileOnly = path.substr(lastSlash + 1);
+    size_t dotPos = fileOnly.find_last_of('.');
+    return fileOnly.substr(0, dotPos);
+}
+
+AnalysisSession::AnalysisSession(const string& path, const OutputOptions& outputOptions)
+    : videoPath(path), baseName(videoBaseName(path)), output(outputOptions) {
+}
+
+AnalysisSession::~AnalysisSession() = default;
+
+string AnalysisSession::outputPath(const string& suffix) const {
+    return output.folder + "/" + baseName + suffix;
+}
+
+void AnalysisSession::recordMeasurements(const AnalysisResult& result) {
+    if (!measurementLog) {
+        measurementLog.reset(new MeasurementLog(outputPath("_measurements.mlog")));
+        if (!measurementLog->isOpen()) {
+            cerr << "Warning: Cannot append to measurement log " << measurementLog->path() << endl;
+        }
+    }
+    measurementLog->append(result);
+}
+
+void AnalysisSession::flushMeasurements() {
+    if (measurementLog) measurementLog->flush();
+}
+
+bool AnalysisSession::setCurrentFrame(const Mat& frame, double timestampMs) {
+    // Both buffers are sized at the first frame
+    if (spareFrame.size() != frame.size() || spareFrame.type() != frame.type()) spareFrame.create(frame.size(), frame.type());
+
+    // A buffer a click analysis still reads must not be overwritten: switch to the other one
+    bool reused = true;
+    if (isShared(currentFrame)) {
+        swap(currentFrame, spareFrame);
+        if (isShared(currentFrame)) {
+            currentFrame.release();   // Both held by clicks: a third buffer
+            reused = false;
+        }
+    }
+    frame.copyTo(currentFrame);
+    currentTimestamp = timestampMs;
+    return reused;
+}
+
+AnalyzerParams AnalysisSession::currentAnalyzerParams() const {
+    AnalyzerParams params;
+    params.brightness = brightnessValue;
+    params.threshold = thresholdValue;
+    return params;
+}
+
+void AnalysisSession::mergeBaseline(int detectedY) {
+    // If this baseline is higher (closer to top) than previous, update it
+    if (detectedY != -1 && (fixedBaselineY == -1 || detectedY < fixedBaselineY)) {
+        fixedBaselineY = baselineFromRow(detectedY);
+        //cout << "Updated fixed baselineY to: " << fixedBaselineY << endl;
+    }
+}
+
+int AnalysisSession::consumePacket(FramePacket& packet) {
+    if (!packet.analyzed) return 0;
+
+    mergeBaseline(packet.detectedY);
+    baselineStability.observe(fixedBaselineY);
+
+    // The worker masked with the baseline known when it ran; trim rows the in-order baseline excludes
+    int cutoff = baselineCutoffRow(fixedBaselineY);
+    if (cutoff != -1 && (packet.maskCutoff == -1 || cutoff < packet.maskCutoff)) {
+        int end = packet.maskCutoff == -1 ? packet.binary.rows : packet.maskCutoff;
+        packet.binary.rowRange(cutoff, end).setTo(0);
+    }
+
+    // The gray frame does not depend on the trackbar values: keep it for rebuilds after a change
+    if (packet.pyramid.scale() > 1) {
+        grayCache.pushLevel(packet.index, packet.pyramid.coarseGray(), packet.pyramid.scale(), packet.frame.size(), cutoff,
+                            convergence.rotationPeriod());
+    }
+    else {
+        grayCache.push(packet.index, packet.gray, cutoff, convergence.rotationPeriod());
+    }
+
+    // Frames analyzed with outdated trackbar values must not enter the fresh accumulation as they are:
+    // re-mask them from their gray frame
+    if (packet.brightness != brightnessValue || packet.threshold != thresholdValue) {
+        fill(packet.tops.begin(), packet.tops.end(), AzimuthEnvelope::kEmpty);
+        if (packet.pyramid.scale() > 1) packet.pyramid.pickMask(brightnessValue, thresholdValue, cutoff, packet.gray, packet.binary, packet.tops);
+        else fusedPickMask(packet.gray, brightnessValue, thresholdValue, cutoff, packet.binary, packet.tops);
+        packet.brightness = brightnessValue;
+        packet.threshold = thresholdValue;
+    }
+
+    // --- FOR AZIMUTH CONTOUR: the worker already reduced the frame to its top rows; O(width) merge ---
+    int changedColumns = azimuthEnvelope.merge(packet.tops, cutoff);
+
+    // The same top rows locate this frame's tips for the pick tracker, again O(width)
+    if (tracker.enabled()) {
+        ScopedTimer timer(output.telemetry, Stage::Track);
+        tracker.observe(packet.index, packet.timestampMs, packet.tops, azimuthEnvelope, fixedBaselineY, changedColumns,
+                        convergence.rotationPeriod(), currentAnalyzerParams());
+    }
+
+    // Drum region for the next frames, learned from the accumulated state
+    drumRoi.observe(packet.index, packet.frame.size(), packet.tops, packet.roi, azimuthEnvelope, fixedBaselineY,
+                    baselineStability.stable(), changedColumns, convergence.rotationPeriod());
+    return changedColumns;
+}
+
+int AnalysisSession::rebuildEnvelope() {
+    int frames = grayCache.rebuild(azimuthEnvelope, brightnessValue, thresholdValue, baselineCutoffRow(fixedBaselineY));
+    if (frames == 0) azimuthEnvelope.reset();
+    tracker.invalidateLanes();
+    drumRoi.relearn();   // New values may show picks outside the learned region
+    return frames;
+}
+
+void AnalysisSession::finishTracking(ostream& console) {
+    if (!tracker.enabled()) return;
+    tracker.finish();
+    tracker.report(console);
+
+    string csvPath = outputPath("_picks.csv");
+    ofstream csv(csvPath);
+    tracker.writeCsv(csv);
+    console << "Pick statistics written to " << csvPath << endl;
+}
+
+ClickAnalysis AnalysisSession::runAnalysis(const Mat& selectedFrame, const AzimuthEnvelope& envelope, float baselineY,
+                                           double timestampMs, const AnalyzerParams& params, const string& filename,
+                                           bool show, const OutputOptions& output) {
+    ClickAnalysis analysis;
+    analysis.filename = filename;
+    {
+        ScopedTimer timer(output.telemetry, Stage::Analysis);
+        analysis.result = FrameAnalyzer::analyze(selectedFrame, envelope, baselineY, timestampMs, params);
+    }
+    if (output.telemetry) output.telemetry->count(Counter::ClicksAnalyzed);
+
+    ScopedTimer timer(output.telemetry, Stage::Render);
+    Overlay overlay = FrameAnalyzer::overlay(analysis.result);
+    // The measurements never need the upsampled frame; its size only matters for display and export
+    const int rasterScale = output.image.rasterScale > 0 ? output.image.rasterScale : params.scale;
+
+    // Encoding is queued to the export threads when there are any
+    auto writeImage = [&output](const string& path, const Mat& image) {
+        if (output.exporter) output.exporter->submit(path, image);
+        else if (!ExportQueue::write(path, image, output.image)) cerr << "Error: Cannot write " << path << endl;
+    };
+    string stem = filename.substr(0, filename.size() - 4);   // Without ".png"
+
+    if (output.image.format == ExportFormat::Svg) {
+        // "Outputs/name_12s.png" -> "Outputs/name_12s_native.png" + "Outputs/name_12s.svg"
+        string nativePath = stem + "_native.png";
+        writeImage(nativePath, selectedFrame);
+        analysis.filename = stem + ".svg";
+        if (!overlay.writeSvg(analysis.filename, nativePath.substr(nativePath.find_last_of("/\\") + 1),
+                              selectedFrame.size(), params.scale)) {
+            cerr << "Error: Cannot write " << analysis.filename << endl;
+            if (output.exporter) output.exporter->countFailure();
+        }
+        if (show) analysis.annotated = overlay.render(selectedFrame, rasterScale);
+        return analysis;
+    }
+
+    analysis.annotated = overlay.render(selectedFrame, rasterScale);
+
+    // Save the zoomed image to disk with timestamp (PNG / JPEG / WebP)
+    analysis.filename = stem + ExportQueue::extension(output.image.format);
+    writeImage(analysis.filename, analysis.annotated);
+
+    //// Save the zoomed image to disk with timestamp - EPS conversion
+    //imwrite(filename, zoomed);
+    //string epsCommand = "magick \"" + filename + "\" -density 96 eps:\"" + filename.substr(0, filename.size() - 4) + ".eps\"";
+    //system(epsCommand.c_str());
+    //// Delete the original PNG file
+    //remove(filename.c_str());
+    //
+    //cout << "\nSaved resampled frame at: Outputs/" << baseName << "_" + to_string(timestamp_sec) + "s.eps" << endl;
+
+    return analysis;
+}
+
+int AnalysisSession::accumulatePipelined(VideoCapture& cap, const PipelineConfig& config) {
+    Telemetry* telemetry = output.telemetry;
+    int frameCount = 0;
+
+    FramePipeline pipeline(cap, config);
+    pipeline.setParameters(brightnessValue, thresholdValue);
+    pipeline.start();
+    while (FramePacket* packet = pipeline.next()) {
+        {
+            ScopedTimer timer(telemetry, Stage::Merge);
+            int changedColumns = consumePacket(*packet);
+            if (tracker.enabled()) convergence.observe(packet->index, packet->binary, changedColumns, fixedBaselineY);   // Period for the pick phases
+            pipeline.publishBaseline(fixedBaselineY, baselineStability.stable());
+            pipeline.publishRoi(drumRoi.region(), drumRoi.probeEvery());
+        }
+        if (telemetry) {
+            telemetry->sampleQueueDepth(pipeline.readyCount());
+            telemetry->tick();
+        }
+        pipeline.release();
+        ++frameCount;
+    }
+    return frameCount;
+}
+
+int AnalysisSession::accumulateInline(VideoCapture& cap, const PipelineConfig& config, long long frameLimit) {
+    Telemetry* telemetry = output.telemetry;
+    FramePacket packet;
+    VideoFileSource source(cap, config.lumaDecode);
+
+    // Same per-frame kernels as the pipeline workers, in decode order on the calling thread
+    for (packet.index = 0; frameLimit < 0 || packet.index < frameLimit; ++packet.index) {
+        {
+            ScopedTimer timer(telemetry, Stage::Decode);
+            if (!source.read(packet.frame, packet.timestampMs)) break;
+        }
+        if (telemetry) telemetry->count(Counter::FramesDecoded);
+        packet.brightness = brightnessValue;
+        packet.threshold = thresholdValue;
+        Rect roi = drumRoi.processed(packet.frame.size(), packet.index);
+        clearOutsideRegion(packet.frame.size(), roi, packet.roi, packet.gray, packet.binary);
+
+        bool detect = BaselineDetector::shouldDetect(config.baseline, packet.index, baselineStability.stable());
+        const bool coarse = config.pyramid.levels > 0;
+        {
+            ScopedTimer timer(telemetry, Stage::Baseline);
+            packet.detectedY = coarse ? packet.pyramid.detectBaselineRow(packet.frame, detect, roi, config.pyramid)
+                                      : detectBaselineRow(packet.frame, packet.gray, detect, roi);
+        }
+
+        float baseline = fixedBaselineY;
+        if (packet.detectedY != -1 && (baseline == -1 || packet.detectedY < baseline)) {
+            baseline = baselineFromRow(packet.detectedY);
+        }
+        packet.maskCutoff = baselineCutoffRow(baseline);
+        {
+            ScopedTimer timer(telemetry, Stage::Mask);
+            fill(packet.tops.begin(), packet.tops.end(), AzimuthEnvelope::kEmpty);
+            if (coarse) packet.pyramid.pickMask(packet.brightness, packet.threshold, packet.maskCutoff, packet.gray, packet.binary, packet.tops);
+            else fusedPickMask(packet.gray, packet.brightness, packet.threshold, packet.maskCutoff, packet.binary, packet.tops, roi);
+        }
+
+        ScopedTimer timer(telemetry, Stage::Merge);
+        int changedColumns = consumePacket(packet);
+        if (tracker.enabled()) convergence.observe(packet.index, packet.binary, changedColumns, fixedBaselineY);   // Period for the pick phases
+    }
+    return static_cast<int>(packet.index);
+}
+
+int AnalysisSession::accumulateChunked(const PipelineConfig& config, int chunks) {
+    vector<FrameRange> ranges = planChunks(videoPath, chunks);
+
+    // ------- MAP: one session + decoder per range ------- //
+    // The ranges process whole frames: a region learned per range would differ from the sequential one
+    DrumRoiConfig fullFrames;
+    fullFrames.enabled = false;
+    TaskPool pool(static_cast<int>(ranges.size()));
+    vector<unique_ptr<AnalysisSession>> parts;
+    vector<future<int>> partFrames;
+    for (const FrameRange& range : ranges) {
+        parts.emplace_back(new AnalysisSession(videoPath, output));
+        AnalysisSession* part = parts.back().get();
+        part->brightnessValue = brightnessValue;
+        part->thresholdValue = thresholdValue;
+        part->drumRoi = DrumRoi(fullFrames);
+
+        partFrames.push_back(pool.submit([part, range, &config]() {
+            VideoCapture cap(part->videoPath);
+            if (!cap.isOpened()) return -1;
+            if (range.start > 0) {
+                cap.set(CAP_PROP_POS_FRAMES, static_cast<double>(range.start));
+                if (static_cast<long long>(cap.get(CAP_PROP_POS_FRAMES)) != range.start) return -1;
+            }
+            return part->accumulateInline(cap, config, range.end < 0 ? -1 : range.end - range.start);
+        }));
+    }
+
+    vector<int> frames;
+    bool complete = true;
+    for (auto& result : partFrames) {
+        frames.push_back(result.get());
+        complete = complete && frames.back() >= 0;
+    }
+    if (!complete) return -1;
+
+    // ------- REDUCE: in frame order ------- //
+    // A range masked its frames with its own baseline; the sequential loop would also have applied the
+    // baseline of all earlier frames, which only ever moves the cutoff up. A column's top row in a frame
+    // is its first foreground row, so the frame still contributes under the lower cutoff exactly when
+    // that row lies above it; the same holds for the range minimum. Taking only the rows above the
+    // cutoff of the earlier ranges therefore reproduces the sequential envelope exactly.
+    int frameCount = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const AnalysisSession& part = *parts[i];
+        azimuthEnvelope.merge(part.azimuthEnvelope, baselineCutoffRow(fixedBaselineY));
+        if (part.fixedBaselineY != -1 && (fixedBaselineY == -1 || part.fixedBaselineY < fixedBaselineY)) {
+            fixedBaselineY = part.fixedBaselineY;
+        }
+        frameCount += frames[i];
+    }
+    return frameCount;
+}
+
+// Headless batch analysis: no HighGUI windows, no waitKey pacing.
+// Pass 1 decodes the whole video as fast as possible to build the baseline and azimuth envelope,
+// pass 2 runs the click analysis on the requested frames against that accumulated state.
+int AnalysisSession::runBatch(const BatchOptions& options, ostream& console, WorkStealingPool* scheduler) {
+    brightnessValue = options.brightness;
+    thresholdValue = options.threshold;
+    tracker = PickTracker(options.tracking);
+    // Whole frames: chunked ranges cannot learn the region the sequential pass would, and both passes
+    // must accumulate the same baseline and envelope
+    DrumRoiConfig wholeFrames = options.roi;
+    wholeFrames.enabled = false;
+    drumRoi = DrumRoi(wholeFrames);
+
+    VideoCapture cap(videoPath);
+    if (!cap.isOpened()) {
+        console << "Error: Cannot open video file " << videoPath << endl;
+        return -1;
+    }
+
+    // ------- PASS 1: BASELINE + AZIMUTH ACCUMULATION ------- //
+    int64 startTicks = getTickCount();
+    PipelineConfig pipelineConfig = options.pipeline;
+    pipelineConfig.loopVideo = false;         // One pass over the video
+    pipelineConfig.computeContours = false;   // No live display in batch mode
+
+    int frameCount = -1;
+    if (!scheduler && options.chunks != 1 && tracker.enabled()) {
+        console << "Note: --chunks is ignored with --track (the picks are tracked in frame order)" << endl;
+    }
+    else if (!scheduler && options.chunks != 1) {
+        // The ranges start without a baseline history, so the stability-based detection skipping would
+        // see different frames than the sequential loop: chunked mode detects on every frame
+        if (pipelineConfig.baseline.everyK > 1) {
+            console << "Note: --baseline-every is ignored with --chunks (the baseline is detected on every frame)" << endl;
+            pipelineConfig.baseline.everyK = 1;
+        }
+        int chunks = options.chunks > 0 ? options.chunks : max(1, static_cast<int>(thread::hardware_concurrency()));
+        frameCount = accumulateChunked(pipelineConfig, chunks);
+        if (frameCount < 0) {
+            console << "Warning: " << baseName << " cannot be split at exact frames, accumulating sequentially" << endl;
+        }
+    }
+    if (frameCount < 0) {
+        frameCount = scheduler ? accumulateInline(cap, pipelineConfig) : accumulatePipelined(cap, pipelineConfig);
+    }
+
+    double pass1Sec = (getTickCount() - startTicks) / getTickFrequency();
+    console << "[BATCH] " << baseName << ": accumulated " << frameCount << " frames in " << pass1Sec << " s ("
+            << (pass1Sec > 0 ? frameCount / pass1Sec : 0) << " frames/s)" << endl;
+    finishTracking(console);
+
+    if (frameCount == 0) {
+        console << "Error: No frames decoded from " << videoPath << endl;
+        return -1;
+    }
+
+    // ------- PASS 2: ANALYSIS OF THE REQUESTED FRAMES ------- //
+    string outTextPath = outputPath("_measurements.txt");
+    ofstream outFile(outTextPath); // One measurement file for the whole batch run
+
+    // The analyses run on all cores; results are written in frame order as they complete
+    unique_ptr<TaskPool> ownPool;
+    if (!scheduler) ownPool.reset(new TaskPool());
+    auto submit = [&](function<ClickAnalysis()> task) {
+        return scheduler ? scheduler->submit(move(task)) : ownPool->submit(move(task));
+    };
+    auto await = [&](future<ClickAnalysis>& result) {
+        return scheduler ? scheduler->get(result) : result.get();
+    };
+
+    deque<future<ClickAnalysis>> inFlight;
+    const size_t maxInFlight = 2 * (scheduler ? scheduler->threadCount() : ownPool->threadCount());  // Bounds the frames held in memory
+    AnalyzerParams params = currentAnalyzerParams();
+    int analyzedCount = 0;
+
+    auto writeOldest = [&]() {
+        ClickAnalysis analysis = await(inFlight.front());
+        inFlight.pop_front();
+        outFile << "\n========== Frame at " << static_cast<int>(analysis.result.timestampMs) << " ms ==========\n";
+        FrameAnalyzer::printMeasurements(analysis.result, console, outFile);
+        recordMeasurements(analysis.result);
+        console << "\nSaved resampled frame as: " << analysis.filename << endl;
+        ++analyzedCount;
+    };
+
+    Mat frame;
+    auto analyzeCurrent = [&]() {
+        Mat selectedFrame = frame.clone();   // frame is reused by the next read
+        double timestampMs = cap.get(CAP_PROP_POS_MSEC);
+        string filename = outputPath("_" + to_string(static_cast<int>(timestampMs)) + "ms.png");
+        float baselineY = fixedBaselineY;
+        const AzimuthEnvelope* envelope = &azimuthEnvelope;
+        const OutputOptions& outputOptions = output;
+
+        inFlight.push_back(submit([=, &params, &outputOptions]() {
+            return runAnalysis(selectedFrame, *envelope, baselineY, timestampMs, params, filename, false, outputOptions);
+        }));
+        if (inFlight.size() >= maxInFlight) writeOldest();
+    };
+
+    for (double sec : options.analyzeAtSec) {
+        cap.set(CAP_PROP_POS_MSEC, sec * 1000.0);
+        if (!cap.read(frame)) {
+            console << "Warning: No frame at " << sec << " s, skipped." << endl;
+            continue;
+        }
+        analyzeCurrent();
+    }
+
+    if (options.analyzeEveryN > 0) {
+        cap.set(CAP_PROP_POS_FRAMES, 0);
+        for (int index = 0; cap.read(frame); ++index) {
+            if (index % options.analyzeEveryN == 0) {
+                analyzeCurrent();
+            }
+        }
+    }
+
+    while (!inFlight.empty()) writeOldest();
+    flushMeasurements();
+
+    console << "\n[BATCH] " << baseName << ": analyzed " << analyzedCount << " frame(s), measurements written to "
+            << outTextPath << " and " << outputPath("_measurements.mlog") << endl;
+    return 0;
+}
+
+int AnalysisSession::runStream(const BatchOptions& options, StreamSource& source, ostream& console) {
+    brightnessValue = options.brightness;
+    thresholdValue = options.threshold;
+    tracker = PickTracker(options.tracking);
+    drumRoi = DrumRoi(options.roi);
+    Telemetry* telemetry = output.telemetry;
+
+    PipelineConfig pipelineConfig = options.pipeline;
+    pipelineConfig.loopVideo = false;         // The producer ends the stream
+    pipelineConfig.computeContours = false;   // No live display
+
+    string outTextPath = outputPath("_measurements.txt");
+    ofstream outFile(outTextPath);
+
+    // The analyses run on all cores; results are written in frame order as they complete
+    TaskPool pool;
+    deque<future<ClickAnalysis>> inFlight;
+    const size_t maxInFlight = 2 * pool.threadCount();   // Bounds the frames held in memory
+    AnalyzerParams params = currentAnalyzerParams();
+    int analyzedCount = 0;
+
+    auto writeOldest = [&]() {
+        ClickAnalysis analysis = inFlight.front().get();
+        inFlight.pop_front();
+        outFile << "\n========== Frame at " << static_cast<int>(analysis.result.timestampMs) << " ms ==========\n";
+        FrameAnalyzer::printMeasurements(analysis.result, console, outFile);
+        recordMeasurements(analysis.result);
+        console << "\nSaved resampled frame as: " << analysis.filename << endl;
+        ++analyzedCount;
+    };
+
+    int64 startTicks = getTickCount();
+    long long frameCount = 0;
+    FramePipeline pipeline(source, pipelineConfig);
+    pipeline.setParameters(brightnessValue, thresholdValue);
+    pipeline.start();
+    while (FramePacket* packet = pipeline.next()) {
+        {
+            ScopedTimer timer(telemetry, Stage::Merge);
+            int changedColumns = consumePacket(*packet);
+            if (tracker.enabled()) convergence.observe(packet->index, packet->binary, changedColumns, fixedBaselineY);   // Period for the pick phases
+            pipeline.publishBaseline(fixedBaselineY, baselineStability.stable());
+            pipeline.publishRoi(drumRoi.region(), drumRoi.probeEvery());
+        }
+
+        if (packet->index % options.analyzeEveryN == 0) {
+            // The packet's frame goes back to the source on release: the analysis gets its own BGR copy
+            Mat selectedFrame;
+            if (packet->frame.channels() == 1) cvtColor(packet->frame, selectedFrame, COLOR_GRAY2BGR);
+            else selectedFrame = packet->frame.clone();
+            double timestampMs = packet->timestampMs;
+            string filename = outputPath("_" + to_string(static_cast<long long>(timestampMs)) + "ms.png");
+            AzimuthEnvelope envelope = azimuthEnvelope;   // Snapshot: the next frames keep refining it
+            float baselineY = fixedBaselineY;
+            const OutputOptions& outputOptions = output;
+
+            inFlight.push_back(pool.submit([=, &params, &outputOptions]() {
+                return runAnalysis(selectedFrame, envelope, baselineY, timestampMs, params, filename, false, outputOptions);
+            }));
+            if (inFlight.size() >= maxInFlight) writeOldest();
+        }
+
+        if (telemetry) {
+            telemetry->sampleQueueDepth(pipeline.readyCount());
+            telemetry->tick();
+        }
+        pipeline.release();
+        ++frameCount;
+    }
+    pipeline.stop();
+
+    while (!inFlight.empty()) writeOldest();
+    flushMeasurements();
+    finishTracking(console);
+
+    double seconds = (getTickCount() - startTicks) / getTickFrequency();
+    console << "\n[STREAM] " << baseName << ": " << frameCount << " frames (" << (seconds > 0 ? frameCount / seconds : 0)
+            << " frames/s), " << pipeline.droppedFrames() << " dropped, analyzed " << analyzedCount
+            << " frame(s), measurements written to " << outTextPath << " and " << outputPath("_measurements.mlog") << endl;
+    if (!source.error().empty()) {
+        console << "Error: Frame stream: " << source.error() << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AzimuthEnvelope.h"
+#include "BaselineDetector.h"
+#include "ConvergenceMonitor.h"
+#include "DrumRoi.h"
+#include "ExportQueue.h"
+#include "FrameAnalyzer.h"
+#include "FramePipeline.h"
+#include "GrayFrameCache.h"
+#include "ParameterSweep.h"
+#include "PlaybackScheduler.h"
+#include "PickTracker.h"
+#include "StreamSource.h"
+
+class MeasurementLog;
+class Telemetry;
+class WorkStealingPool;
+
+// ------- ANALYSIS SESSION ------- //
+// Everything that belongs to the analysis of one video: the frame on display, the merged baseline,
+// the trackbar values and the accumulated azimuth envelope. Several sessions can live in one process,
+// e.g. one per video in the multi-video batch runner.
+
+// Finished analysis of one selected frame
+struct ClickAnalysis {
+    AnalysisResult result;
+    cv::Mat annotated;        // Resampled frame with all overlays (empty if not rendered)
+    std::string filename;     // PNG or SVG the annotated frame was saved to
+};
+
+// Where and how analysis results are written
+struct OutputOptions {
+    std::string folder = "Outputs";
+    ExportOptions image;               // --format / --quality (--svg : native frame + vector overlay)
+    ExportQueue* exporter = nullptr;   // Background encoders for the annotated frames (nullptr = write inline)
+    Telemetry* telemetry = nullptr;    // --telemetry / --hud : stage timers and counters (nullptr = off)
+};
+
+// Command line options (--batch / --batch-dir select the headless mode, the rest also apply to
+// interactive playback)
+struct BatchOptions {
+    std::string videoPath;
+    std::string videoDir;              // --batch-dir <folder> : every video in the folder, in parallel
+    std::vector<double> analyzeAtSec;  // --at 1.0,2.5,... : analysis timestamps in seconds
+    int analyzeEveryN = 0;             // --every N : analyze every N-th frame (0 = off)
+    int brightness = 11;               // --brightness
+    int threshold = 101;               // --threshold
+    PipelineConfig pipeline;           // --workers / --queue / --drop-decode / --baseline-every
+    SweepOptions sweep;                // --sweep <video> : brightness / threshold ranking instead of an analysis
+    StreamConfig stream;               // --stream <source> : raw frames of a capture process instead of a video file
+    int chunks = 1;                    // --chunks N : pass 1 on N decoders over time ranges (0 = one per core)
+    PlaybackConfig playback;           // --late / --display-fps / --preview-width : interactive real-time pacing
+    ConvergenceConfig convergence;     // --monitor-every N : interactive analysis cadence once the contour converged
+    GrayCacheConfig grayCache;         // --gray-cache-mb / --gray-cache-scale : interactive instant recomputation
+    TrackerConfig tracking;            // --track / --track-tolerance : per-frame pick tracking in every mode
+    DrumRoiConfig roi;                 // --no-roi / --roi-refresh : drum region of the stream (batch pass 1 uses whole frames)
+    std::string telemetryPath;         // --telemetry <file.csv|file.json> : periodic stage statistics
+    double telemetryInterval = 2.0;    // --telemetry-interval <s>
+    bool hud = false;                  // --hud : stage statistics on the video (toggle with 'h')
+    OutputOptions output;
+};
+
+class AnalysisSession {
+public:
+    AnalysisSession(const std::string& videoPath, const OutputOptions& output);
+    ~AnalysisSession();
+
+    // Output file of this video: <folder>/<base name><suffix>
+    std::string outputPath(const std::string& suffix) const;
+
+    // Appends the measurements of an analyzed frame to <folder>/<base>_measurements.mlog (opened on first
+    // use, written in batches by a background thread)
+    void recordMeasurements(const AnalysisResult& result);
+    // Waits until every recorded frame is on disk
+    void flushMeasurements();
+
+    // Makes a decoded frame the current frame for the click handler. It is copied into one of two reused
+    // buffers: clicks share currentFrame instead of cloning it, and while an analysis still holds one
+    // buffer the other takes the next frames, so the frame loop does not allocate. Returns false if clicks
+    // held both buffers and a new one had to be allocated.
+    bool setCurrentFrame(const cv::Mat& frame, double timestampMs);
+
+    // Parameters of an analysis with the current trackbar values
+    AnalyzerParams currentAnalyzerParams() const;
+
+    // Merges a per-frame baseline candidate: keeps the uppermost (closest to top) baseline detected so far
+    void mergeBaseline(int detectedY);
+    // Consumer stage of the pipeline: merges an analyzed frame into the baseline and azimuth envelope.
+    // Runs in decode order, so the result is the same as processing the frames one after another.
+    // Returns the number of envelope columns the frame moved (0 for frames passed through unanalyzed).
+    int consumePacket(FramePacket& packet);
+    // Rebuilds the azimuth envelope from the gray frame cache with the current trackbar values (after a
+    // trackbar change). Returns the number of cached frames used, 0 = envelope cleared.
+    int rebuildEnvelope();
+    // Ends the tracked passages and reports the pick statistics to console and <folder>/<base>_picks.csv
+    // (nothing if tracking is off)
+    void finishTracking(std::ostream& console);
+
+    // Headless analysis of the whole video; reports go to console, measurements to the output folder.
+    // Without a scheduler pass 1 runs on a FramePipeline (or on one decoder per time range with
+    // options.chunks) and pass 2 on a TaskPool of its own. With one (multi-video runner) pass 1 runs on
+    // the calling thread and the pass 2 analyses are spawned on the shared scheduler. Returns 0 on
+    // success, -1 if the video cannot be read.
+    int runBatch(const BatchOptions& options, std::ostream& console, WorkStealingPool* scheduler = nullptr);
+
+    // Headless analysis of a raw frame stream as one stage of a capture pipeline: every frame is merged
+    // into the baseline and envelope as it arrives, and every options.analyzeEveryN-th frame is analyzed
+    // against the state accumulated up to it. Runs until the producer ends the stream. Returns 0, or -1
+    // if the stream broke off.
+    int runStream(const BatchOptions& options, StreamSource& source, std::ostream& console);
+
+    // Analysis of a selected frame against a snapshot of the accumulated state (runs on a worker thread):
+    // measurements, annotated resampled frame and its image file (filename is given as <name>.png, the
+    // extension follows output.image.format). With the Svg format the native frame is saved as PNG and
+    // the overlay as an SVG on top of it; the resampled frame is then only rendered if shown. Images go
+    // to output.exporter when set, so the call returns before they are encoded.
+    static ClickAnalysis runAnalysis(const cv::Mat& selectedFrame, const AzimuthEnvelope& envelope, float baselineY,
+                                     double timestampMs, const AnalyzerParams& params, const std::string& filename,
+                                     bool show, const OutputOptions& output);
+
+    // ---- Session state ----
+    std::string videoPath;
+    std::string baseName = "frame";    // Video file name without folder and extension
+    OutputOptions output;
+
+    cv::Mat currentFrame;              // Frame currently being displayed in the video loop
+    double currentTimestamp = 0.0;     // Current video timestamp in ms
+    float fixedBaselineY = -1;         // Uppermost baseline detected so far
+
+    int brightnessValue = 11;          // Brightness offset, default = 11
+    int thresholdValue = 101;          // Binary threshold, default = 101
+    int prevBrightnessValue = -1;      // Previous brightness value before user adjustment
+    int prevThresholdValue = -1;       // Previous threshold value before user adjustment
+
+    AzimuthEnvelope azimuthEnvelope;   // Highest foreground row per column across frames
+    BaselineStability baselineStability; // How long fixedBaselineY has stayed unchanged
+    ConvergenceMonitor convergence;    // Whether the envelope still changes (interactive analysis cadence)
+    GrayFrameCache grayCache{ GrayCacheConfig{ 0, 1 } }; // Gray frames of the last rotation (off unless configured)
+    PickTracker tracker;               // Per-frame tips and pick statistics (off unless configured)
+    DrumRoi drumRoi;                   // Region the per-frame kernels process, learned over the first rotation
+
+private:
+    std::unique_ptr<MeasurementLog> measurementLog;
+    cv::Mat spareFrame;                // Second buffer of setCurrentFrame
+
+    // Pass 1 variants; all return the number of frames merged
+    int accumulatePipelined(cv::VideoCapture& cap, const PipelineConfig& config);
+    // frameLimit: stop after this many frames (-1 = until the end of the video)
+    int accumulateInline(cv::VideoCapture& cap, const PipelineConfig& config, long long frameLimit = -1);
+    // Map-reduce over time ranges: every range is accumulated by its own session and decoder, the partial
+    // baselines and envelopes are then merged in frame order. Returns -1 (state untouched) if a decoder
+    // cannot seek exactly to its range.
+    int accumulateChunked(const PipelineConfig& config, int chunks);
+};
+
+// Video base name for output naming ("Resources/video_0.mp4" -> "video_0")
+std::string videoBaseName(const std::string& path);
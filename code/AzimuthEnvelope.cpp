@@ -0,0 +1,123 @@
+#include "AzimuthEnvelope.h"
+#include <opencv2/core/hal/intrin.hpp>  // OpenCV universal intrinsics (SSE/AVX/NEON)
+#include <algorithm>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+const unsigned short AzimuthEnvelope::kEmpty;
+
+void AzimuthEnvelope::reset(int width) {
+    top.assign(max(0, width), kEmpty);
+}
+
+int AzimuthEnvelope::coveredColumns() const {
+    return static_cast<int>(top.size() - count(top.begin(), top.end(), kEmpty));
+}
+
+int AzimuthEnvelope::update(const Mat& binary, int startRow, int endRow) {
+    CV_Assert(binary.type() == CV_8UC1);
+    if (width() != binary.cols) reset(binary.cols);
+
+    startRow = max(0, startRow);
+    endRow = endRow < 0 ? binary.rows : min(endRow, binary.rows);
+
+    previous = top;
+    ushort* env = top.data();
+    const int cols = binary.cols;
+
+    // Top-down scan: a foreground pixel in row y lowers the column's envelope to y
+    for (int y = startRow; y < endRow; ++y) {
+        const uchar* mask = binary.ptr<uchar>(y);
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = VTraits<v_uint16>::vlanes();
+        v_uint16 row = vx_setall_u16(static_cast<ushort>(y));
+        v_uint16 none = vx_setall_u16(kEmpty);
+        v_uint16 zero = vx_setzero_u16();
+        for (; x <= cols - lanes; x += lanes) {
+            v_uint16 candidate = v_select(v_gt(vx_load_expand(mask + x), zero), row, none);
+            v_store(env + x, v_min(vx_load(env + x), candidate));
+        }
+#endif
+        for (; x < cols; ++x) {
+            if (mask[x] && y < env[x]) env[x] = static_cast<ushort>(y);
+        }
+    }
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    vx_cleanup();
+#endif
+
+    int changed = 0;
+    for (int x = 0; x < cols; ++x) {
+        changed += env[x] != previous[x];
+    }
+    return changed;
+}
+
+int AzimuthEnvelope::merge(const AzimuthEnvelope& other, int endRow) {
+    return merge(other.top, endRow);
+}
+
+int AzimuthEnvelope::merge(const vector<ushort>& rows, int endRow) {
+    if (rows.empty()) return 0;
+    if (top.empty()) reset(static_cast<int>(rows.size()));
+    CV_Assert(rows.size() == top.size());
+
+    const ushort limit = endRow < 0 ? kEmpty : static_cast<ushort>(min<int>(endRow, kEmpty));
+    int changed = 0;
+    for (size_t x = 0; x < top.size(); ++x) {
+        if (rows[x] < top[x] && rows[x] < limit) {
+            top[x] = rows[x];
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+vector<vector<Point>> AzimuthEnvelope::outline() const {
+    vector<vector<Point>> runs;
+    outline(runs);
+    return runs;
+}
+
+void AzimuthEnvelope::outline(vector<vector<Point>>& runs) const {
+    const int cols = width();
+    size_t used = 0;
+
+    for (int x = 0; x < cols; ++x) {
+        if (top[x] == kEmpty) continue;
+
+        // Start of a run of covered columns
+        if (used == runs.size()) runs.emplace_back();
+        vector<Point>& run = runs[used++];
+        run.clear();
+        int start = x;
+        while (x < cols && top[x] != kEmpty) ++x;
+        int end = x - 1;
+
+        // Keep the run ends and every point where the row changes on either side
+        for (int c = start; c <= end; ++c) {
+            bool edge = c == start || c == end || top[c] != top[c - 1] || top[c] != top[c + 1];
+            if (edge) run.emplace_back(c, top[c]);
+        }
+    }
+    runs.resize(used);
+}
+
+vector<Point> AzimuthEnvelope::corners(const vector<Point>& run, float baselineY, double epsilonFactor) {
+    vector<Point> approx;
+    if (run.size() < 3) return run;
+
+    // Perimeter of the run closed down to the baseline (the accumulated region's outer contour)
+    int bottom = static_cast<int>(baselineY);
+    if (baselineY == -1) {
+        for (const Point& pt : run) bottom = max(bottom, pt.y);
+    }
+    double perimeter = arcLength(run, false)
+                     + (run.back().x - run.front().x)
+                     + max(0, bottom - run.front().y) + max(0, bottom - run.back().y);
+
+    approxPolyDP(run, approx, epsilonFactor * perimeter, false);
+    return approx;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- AZIMUTH ENVELOPE ------- //
+// Upper outline of everything the picks covered so far: for every column the highest (smallest y)
+// foreground row seen in any thresholded frame. It replaces the accumulated W x H binary mask whose
+// only use was recovering this outline with findContours: memory is W values, the per-frame update is
+// one vectorized min over the masked band and the outline / corner extraction is O(width).
+class AzimuthEnvelope {
+public:
+    static const unsigned short kEmpty = 0xFFFF;   // Column without foreground so far
+
+    // Forget everything (width 0 = adopt the width of the next update)
+    void reset(int width = 0);
+    // Replaces the envelope by top rows computed elsewhere (kEmpty = column without foreground)
+    void assign(const std::vector<unsigned short>& rows) { top = rows; }
+
+    bool empty() const { return coveredColumns() == 0; }
+    int width() const { return static_cast<int>(top.size()); }
+    int coveredColumns() const;
+
+    // Top row per column, kEmpty where nothing was seen
+    const std::vector<unsigned short>& rows() const { return top; }
+
+    // Merges the foreground of an 8-bit mask, scanning only rows [startRow, endRow) (endRow -1 = all).
+    // Returns the number of columns whose top row moved up.
+    int update(const cv::Mat& binary, int startRow = 0, int endRow = -1);
+
+    // Merges another envelope of the same width (per-column minimum), only taking its rows above endRow
+    // (endRow -1 = all). Returns the number of columns whose top row moved up.
+    int merge(const AzimuthEnvelope& other, int endRow = -1);
+    // Same for top rows computed elsewhere (e.g. the per-frame tops of fusedPickMask)
+    int merge(const std::vector<unsigned short>& rows, int endRow = -1);
+
+    // Azimuth contour: one polyline per run of covered columns, reduced to the points where the row
+    // changes (like CHAIN_APPROX_SIMPLE)
+    std::vector<std::vector<cv::Point>> outline() const;
+    // Same, into runs: the polylines of an earlier call are reused, so a per-frame outline does not allocate
+    void outline(std::vector<std::vector<cv::Point>>& runs) const;
+
+    // Corner points of one outline run (red dot candidates). The run is closed down to baselineY
+    // (or its lowest point when no baseline is known) to size the approxPolyDP tolerance the same way
+    // as for the closed contour of the accumulated mask.
+    static std::vector<cv::Point> corners(const std::vector<cv::Point>& run, float baselineY, double epsilonFactor = 0.0025);
+
+private:
+    std::vector<unsigned short> top;
+    std::vector<unsigned short> previous;   // Scratch copy for counting changed columns
+};
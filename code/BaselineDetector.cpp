@@ -0,0 +1,156 @@
+#include "BaselineDetector.h"
+#include <opencv2/core/hal/intrin.hpp>  // OpenCV universal intrinsics (SSE/AVX/NEON)
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// 5x5 Gaussian (sigma 2) followed by the 3x3 Sobel Y is separable into one 7-tap column kernel
+// (Gaussian * [-1 0 1], antisymmetric) and one 7-tap row kernel (Gaussian * [1 2 1], symmetric)
+struct FusedKernel {
+    float column[4];   // column[k] weights row y+k, row y-k gets -column[k] (column[0] = 0)
+    float row[4];      // row[k] weights columns x+k and x-k
+
+    FusedKernel() {
+        Mat g = getGaussianKernel(5, 2.0, CV_64F);
+        auto gauss = [&](int k) { return (k < -2 || k > 2) ? 0.0 : g.at<double>(k + 2); };
+        for (int k = 0; k <= 3; ++k) {
+            column[k] = static_cast<float>(gauss(k - 1) - gauss(k + 1));
+            row[k] = static_cast<float>(gauss(k - 1) + 2.0 * gauss(k) + gauss(k + 1));
+        }
+    }
+};
+
+const FusedKernel& fusedKernel() {
+    static const FusedKernel kernel;
+    return kernel;
+}
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+// Load VTraits<v_float32>::vlanes() pixels as floats
+inline v_float32 loadPixels(const uchar* p) {
+    return v_cvt_f32(v_reinterpret_as_s32(vx_load_expand_q(p)));
+}
+#endif
+
+// Gradient energy of one row. vrow is scratch space of gray.cols + 6 floats (the column-filtered row
+// plus 3 reflected pixels on each side).
+float rowEnergyAt(const Mat& gray, int y, float* vrow, bool useSimd) {
+    const FusedKernel& k = fusedKernel();
+    const int width = gray.cols;
+
+    const uchar* up[3];
+    const uchar* down[3];
+    for (int i = 1; i <= 3; ++i) {
+        up[i - 1] = gray.ptr<uchar>(borderInterpolate(y - i, gray.rows, BORDER_REFLECT_101));
+        down[i - 1] = gray.ptr<uchar>(borderInterpolate(y + i, gray.rows, BORDER_REFLECT_101));
+    }
+
+    // Column pass: blurred vertical derivative of every pixel of the row
+    float* v = vrow + 3;
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = VTraits<v_float32>::vlanes();
+    if (useSimd) {
+        v_float32 c1 = vx_setall_f32(k.column[1]), c2 = vx_setall_f32(k.column[2]), c3 = vx_setall_f32(k.column[3]);
+        for (; x <= width - lanes; x += lanes) {
+            v_float32 s = v_mul(v_sub(loadPixels(down[0] + x), loadPixels(up[0] + x)), c1);
+            s = v_fma(v_sub(loadPixels(down[1] + x), loadPixels(up[1] + x)), c2, s);
+            s = v_fma(v_sub(loadPixels(down[2] + x), loadPixels(up[2] + x)), c3, s);
+            v_store(v + x, s);
+        }
+    }
+#endif
+    for (; x < width; ++x) {
+        v[x] = k.column[1] * (down[0][x] - up[0][x])
+             + k.column[2] * (down[1][x] - up[1][x])
+             + k.column[3] * (down[2][x] - up[2][x]);
+    }
+
+    // Reflect-101 border so the row pass needs no bounds checks
+    for (int i = 1; i <= 3; ++i) {
+        v[-i] = v[min(i, width - 1)];
+        v[width - 1 + i] = v[max(width - 1 - i, 0)];
+    }
+
+    // Row pass + abs + sum
+    float energy = 0;
+    x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    if (useSimd) {
+        v_float32 r0 = vx_setall_f32(k.row[0]), r1 = vx_setall_f32(k.row[1]);
+        v_float32 r2 = vx_setall_f32(k.row[2]), r3 = vx_setall_f32(k.row[3]);
+        v_float32 acc = vx_setzero_f32();
+        for (; x <= width - lanes; x += lanes) {
+            v_float32 s = v_mul(vx_load(v + x), r0);
+            s = v_fma(v_add(vx_load(v + x - 1), vx_load(v + x + 1)), r1, s);
+            s = v_fma(v_add(vx_load(v + x - 2), vx_load(v + x + 2)), r2, s);
+            s = v_fma(v_add(vx_load(v + x - 3), vx_load(v + x + 3)), r3, s);
+            acc = v_add(acc, v_abs(s));
+        }
+        energy = v_reduce_sum(acc);
+        vx_cleanup();
+    }
+#endif
+    for (; x < width; ++x) {
+        float s = k.row[0] * v[x]
+                + k.row[1] * (v[x - 1] + v[x + 1])
+                + k.row[2] * (v[x - 2] + v[x + 2])
+                + k.row[3] * (v[x - 3] + v[x + 3]);
+        energy += std::abs(s);
+    }
+    return energy;
+}
+
+void bandEnergy(const Mat& gray, int startY, int endY, vector<float>& energy, bool useSimd) {
+    CV_Assert(gray.type() == CV_8UC1);
+    energy.assign(max(0, endY - startY), 0.f);
+
+    // Rows are independent: split the band across threads, each with its own row buffer (kept across
+    // frames, so it is only allocated once per thread)
+    parallel_for_(Range(startY, max(startY, endY)), [&](const Range& range) {
+        thread_local vector<float> vrow;
+        vrow.resize(gray.cols + 6);
+        for (int y = range.start; y < range.end; ++y) {
+            energy[y - startY] = rowEnergyAt(gray, y, vrow.data(), useSimd);
+        }
+    });
+}
+
+} // namespace
+
+void BaselineDetector::rowEnergy(const Mat& gray, int startY, int endY, vector<float>& energy) {
+    bandEnergy(gray, startY, endY, energy, true);
+}
+
+void BaselineDetector::rowEnergyReference(const Mat& gray, int startY, int endY, vector<float>& energy) {
+    bandEnergy(gray, startY, endY, energy, false);
+}
+
+int BaselineDetector::detectRow(const Mat& gray) {
+    return detectRow(gray, Rect(0, 0, gray.cols, gray.rows));
+}
+
+int BaselineDetector::detectRow(const Mat& gray, const Rect& roi) {
+    int startY = max(bandStart(gray.rows), roi.y);
+    int endY = min(bandEnd(gray.rows), roi.y + roi.height);
+    if (roi.width <= 0 || endY <= startY) return -1;
+
+    thread_local vector<float> energy;  // Reused across frames of the same thread
+    rowEnergy(gray.colRange(roi.x, roi.x + roi.width), startY, endY, energy);
+
+    float maxEnergy = 0;
+    int detectedY = -1;
+
+    // Loop over rows to find the strongest horizontal edge
+    for (int y = startY; y < endY; ++y) {
+        float e = energy[y - startY];
+        if (e > maxEnergy) {
+            maxEnergy = e;
+            detectedY = y;
+        }
+    }
+    return detectedY;
+}
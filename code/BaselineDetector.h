@@ -0,0 +1,62 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- BASELINE DETECTOR ------- //
+// The baseline is the strongest horizontal edge between 50% and 90% of the frame height. Instead of
+// blurring and differentiating the whole frame, the detector evaluates only the rows of that scan band
+// in one fused pass: 5x5 Gaussian (sigma 2) + 3x3 Sobel Y + abs + row sum, folded into one separable
+// 7x7 kernel. The only temporary is one float row per thread; no intermediate image is allocated.
+
+struct BaselineDetectorConfig {
+    int everyK = 1;          // Once the baseline is stable, run the detector only on every K-th frame
+    int stableFrames = 60;   // Frames without a baseline change after which the baseline counts as stable
+};
+
+class BaselineDetector {
+public:
+    // Scan band of a frame with the given height: rows [startY, endY)
+    static int bandStart(int rows) { return rows / 2; }            // Mid-point
+    static int bandEnd(int rows) { return rows * 9 / 10; }         // 90% of the image height towards bottom
+
+    // Baseline candidate of a raw (unblurred) 8-bit gray frame: the band row with the highest vertical
+    // gradient energy, or -1 if the band has no edge at all
+    static int detectRow(const cv::Mat& gray);
+    // The same inside a region of the frame (the drum ROI): band rows within it, energy of its columns
+    static int detectRow(const cv::Mat& gray, const cv::Rect& roi);
+
+    // Vertical gradient energy of rows [startY, endY) of a raw 8-bit gray frame (energy[i] = row startY + i)
+    static void rowEnergy(const cv::Mat& gray, int startY, int endY, std::vector<float>& energy);
+
+    // Scalar version of rowEnergy (verification of the vectorized kernel)
+    static void rowEnergyReference(const cv::Mat& gray, int startY, int endY, std::vector<float>& energy);
+
+    // Whether the frame with this index needs a detection given the current stability of the baseline
+    static bool shouldDetect(const BaselineDetectorConfig& config, long long frameIndex, bool baselineStable) {
+        return !baselineStable || config.everyK <= 1 || frameIndex % config.everyK == 0;
+    }
+};
+
+// Tracks how long the merged baseline has stayed unchanged
+class BaselineStability {
+public:
+    explicit BaselineStability(int stableFrames = 60) : requiredFrames(stableFrames) {}
+
+    // Call once per merged frame with the current fixed baseline
+    void observe(float baselineY) {
+        if (baselineY != lastBaselineY) {
+            lastBaselineY = baselineY;
+            unchangedFrames = 0;
+        }
+        else {
+            ++unchangedFrames;
+        }
+    }
+    bool stable() const { return lastBaselineY != -1 && unchangedFrames >= requiredFrames; }
+    void reset() { lastBaselineY = -1; unchangedFrames = 0; }
+
+private:
+    int requiredFrames;
+    float lastBaselineY = -1;
+    int unchangedFrames = 0;
+};
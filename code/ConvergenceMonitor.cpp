@@ -0,0 +1,121 @@
+#include "ConvergenceMonitor.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+int greatestCommonDivisor(int a, int b) {
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+} // namespace
+
+const int ConvergenceMonitor::kBins;
+const int ConvergenceMonitor::kMinPeriod;
+
+ConvergenceMonitor::ConvergenceMonitor(const ConvergenceConfig& monitorConfig) : config(monitorConfig) {
+    // Sized once: the period search does not allocate per frame
+    signatures.reserve(static_cast<size_t>(2 * config.maxPeriod) * kBins);
+    lagDistance.resize(max(config.maxPeriod, kMinPeriod) + 1);
+}
+
+void ConvergenceMonitor::reset() {
+    isConverged = false;
+    analyzedFrames = 0;
+    convergedAfter = 0;
+    quietFrames = 0;
+    lastIndex = -1;
+    lastBaselineY = -1;
+    signatures.clear();
+}
+
+bool ConvergenceMonitor::observe(long long frameIndex, const Mat& binary, int changedColumns, float baselineY) {
+    bool quiet = changedColumns == 0 && baselineY == lastBaselineY;
+    bool consecutive = frameIndex == lastIndex + 1;
+    lastBaselineY = baselineY;
+    lastIndex = frameIndex;
+    ++analyzedFrames;
+
+    // ------- MONITORING CADENCE ------- //
+    if (isConverged) {
+        if (quiet) return false;
+        isConverged = false;
+        quietFrames = 0;
+        signatures.clear();
+        return true;
+    }
+
+    // ------- FULL RATE ------- //
+    // The period search needs consecutive frames: frames skipped around a cadence switch break the series
+    if (period == 0) {
+        if (!consecutive) signatures.clear();
+        int frames = static_cast<int>(signatures.size()) / kBins;
+        if (frames < 2 * config.maxPeriod) {
+            recordSignature(binary);
+            if (++frames % 32 == 0) period = estimatePeriod();
+        }
+    }
+
+    quietFrames = quiet ? quietFrames + 1 : 0;
+    int needed = period > 0 ? max(config.minQuietFrames, period) : config.fallbackQuietFrames;
+    if (config.monitorEvery <= 1 || quietFrames < needed) return false;
+
+    isConverged = true;
+    convergedAfter = analyzedFrames;
+
+    // A cadence sharing a factor with the period would only ever sample a few drum positions
+    monitorCadence = config.monitorEvery;
+    while (period > 0 && greatestCommonDivisor(monitorCadence, period) != 1) ++monitorCadence;
+    return true;
+}
+
+void ConvergenceMonitor::recordSignature(const Mat& binary) {
+    // Foreground fraction of kBins vertical stripes: coarse, but it follows the picks around the drum
+    for (int b = 0; b < kBins; ++b) {
+        int x0 = binary.cols * b / kBins;
+        int x1 = binary.cols * (b + 1) / kBins;
+        double area = static_cast<double>(x1 - x0) * binary.rows;
+        signatures.push_back(area > 0 ? static_cast<float>(countNonZero(binary.colRange(x0, x1)) / area) : 0.f);
+    }
+}
+
+int ConvergenceMonitor::estimatePeriod() {
+    const int frames = static_cast<int>(signatures.size()) / kBins;
+    const int maxLag = min(config.maxPeriod, frames / 2);
+    if (maxLag <= kMinPeriod) return 0;
+
+    // Mean profile difference between frames `lag` apart
+    vector<double>& distance = lagDistance;
+    for (int lag = kMinPeriod - 1; lag <= maxLag; ++lag) {
+        double sum = 0.0;
+        for (int t = lag; t < frames; ++t) {
+            const float* a = &signatures[t * kBins];
+            const float* b = &signatures[(t - lag) * kBins];
+            for (int i = 0; i < kBins; ++i) sum += fabs(a[i] - b[i]);
+        }
+        distance[lag] = sum / (static_cast<double>(frames - lag) * kBins);
+    }
+
+    double mean = 0.0, best = HUGE_VAL;
+    for (int lag = kMinPeriod; lag <= maxLag; ++lag) {
+        mean += distance[lag];
+        best = min(best, distance[lag]);
+    }
+    mean /= maxLag - kMinPeriod + 1;
+    if (mean <= 0.0 || best > 0.5 * mean) return 0;   // No clear repetition (yet)
+
+    // Multiples of the period match about as well: take the first dip that gets close to the best one
+    for (int lag = kMinPeriod; lag <= maxLag; ++lag) {
+        bool dip = distance[lag] < distance[lag - 1] && (lag == maxLag || distance[lag] <= distance[lag + 1]);
+        if (dip && distance[lag] <= 1.2 * best) return lag;
+    }
+    return 0;
+}
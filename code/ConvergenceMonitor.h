@@ -0,0 +1,59 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- CONVERGENCE MONITOR ------- //
+// Once the drum has turned far enough for every pick position to be seen, new frames no longer move
+// the azimuth envelope. The monitor counts the envelope columns every analyzed frame moves, estimates
+// the rotation period from the repetition of a coarse per-frame pick profile and, after a full period
+// without any change, drops the analysis to a sparse monitoring cadence. Any change seen on a
+// monitoring frame (envelope or baseline) switches back to full rate; so does reset(), e.g. after the
+// trackbar values change.
+
+struct ConvergenceConfig {
+    int monitorEvery = 8;             // Analysis cadence once converged (every N-th frame, 1 = never reduce)
+    int minQuietFrames = 30;          // Unchanged frames needed at least, even for a short period
+    int fallbackQuietFrames = 240;    // Unchanged frames needed while the period is unknown
+    int maxPeriod = 600;              // Longest rotation period searched (frames)
+};
+
+class ConvergenceMonitor {
+public:
+    explicit ConvergenceMonitor(const ConvergenceConfig& config = ConvergenceConfig());
+
+    // Back to full rate with an empty envelope history (the period estimate is kept: the drum speed
+    // does not depend on the trackbar values)
+    void reset();
+
+    // One analyzed frame in decode order: its masked binary, the number of envelope columns it moved
+    // and the merged baseline after it. Returns true if the cadence changed.
+    bool observe(long long frameIndex, const cv::Mat& binary, int changedColumns, float baselineY);
+
+    bool converged() const { return isConverged; }
+    // Analyze every cadence()-th frame (1 = full rate)
+    int cadence() const { return isConverged ? monitorCadence : 1; }
+    // Frames per repeat of the pick profile, 0 while unknown
+    int rotationPeriod() const { return period; }
+    // Analyzed frames from the last reset until the envelope converged
+    long long framesToConverge() const { return convergedAfter; }
+
+private:
+    static const int kBins = 32;      // Columns of the pick profile signature
+    static const int kMinPeriod = 4;
+
+    void recordSignature(const cv::Mat& binary);
+    int estimatePeriod();
+
+    ConvergenceConfig config;
+    bool isConverged = false;
+    int monitorCadence = 1;
+    int period = 0;
+    long long analyzedFrames = 0;     // Since the last reset
+    long long convergedAfter = 0;
+    int quietFrames = 0;              // Consecutive analyzed frames that moved no column
+    long long lastIndex = -1;
+    float lastBaselineY = -1;
+
+    std::vector<float> signatures;    // kBins values per frame of consecutive full-rate frames, oldest first
+    std::vector<double> lagDistance;  // Scratch of estimatePeriod, per lag
+};
@@ -0,0 +1,108 @@
+#include "DrumRoi.h"
+#include "FrameProcessing.h"
+#include <algorithm>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+DrumRoi::DrumRoi(const DrumRoiConfig& roiConfig) : config(roiConfig) {
+}
+
+void DrumRoi::relearn() {
+    roi = Rect();
+    learnStart = -1;
+}
+
+Rect DrumRoi::processed(Size frameSize) const {
+    Rect frame(0, 0, frameSize.width, frameSize.height);
+    return roi.empty() ? frame : roi & frame;
+}
+
+Rect DrumRoi::processed(Size frameSize, long long frameIndex) const {
+    bool probe = !roi.empty() && probeEvery() > 0 && frameIndex % probeEvery() == 0;
+    return probe ? Rect(0, 0, frameSize.width, frameSize.height) : processed(frameSize);
+}
+
+double DrumRoi::coverage(Size frameSize) const {
+    double area = static_cast<double>(frameSize.area());
+    return area > 0 ? processed(frameSize).area() / area : 1.0;
+}
+
+bool DrumRoi::touchesBorder(const AzimuthEnvelope& envelope, Size frameSize) const {
+    const vector<unsigned short>& rows = envelope.rows();
+    const int topMask = static_cast<int>(0.1 * frameSize.height);
+    const int left = roi.x, right = min(roi.x + roi.width, envelope.width()) - 1;
+    if (right < left) return false;
+
+    // Foreground in an outer column (unless the region ends at the frame edge there) or up to the top row
+    if (left > 0 && rows[left] != AzimuthEnvelope::kEmpty) return true;
+    if (right < frameSize.width - 1 && rows[right] != AzimuthEnvelope::kEmpty) return true;
+    if (roi.y <= topMask) return false;
+    for (int x = left; x <= right; ++x) {
+        if (rows[x] <= roi.y) return true;
+    }
+    return false;
+}
+
+bool DrumRoi::foregroundOutside(const vector<unsigned short>& tops) const {
+    const int width = static_cast<int>(tops.size());
+    const int left = min(roi.x, width), right = min(roi.x + roi.width, width);
+    for (int x = 0; x < left; ++x) {
+        if (tops[x] != AzimuthEnvelope::kEmpty) return true;
+    }
+    for (int x = right; x < width; ++x) {
+        if (tops[x] != AzimuthEnvelope::kEmpty) return true;
+    }
+    for (int x = left; x < right; ++x) {
+        if (tops[x] < roi.y) return true;
+    }
+    return false;
+}
+
+Rect DrumRoi::learn(const AzimuthEnvelope& envelope, float baselineY, Size frameSize) const {
+    const vector<unsigned short>& rows = envelope.rows();
+    int left = -1, right = -1;
+    int top = AzimuthEnvelope::kEmpty;
+    for (int x = 0; x < envelope.width(); ++x) {
+        if (rows[x] == AzimuthEnvelope::kEmpty) continue;
+        if (left == -1) left = x;
+        right = x;
+        top = min(top, static_cast<int>(rows[x]));
+    }
+    int bottom = baselineCutoffRow(baselineY);
+    if (left == -1 || bottom == -1) return Rect();   // Nothing seen: stay on full frames
+
+    const int m = config.margin;
+    return Rect(Point(left - m, top - m), Point(right + 1 + m, bottom + m)) & Rect(0, 0, frameSize.width, frameSize.height);
+}
+
+bool DrumRoi::observe(long long frameIndex, Size frameSize, const vector<unsigned short>& tops, const Rect& processed,
+                      const AzimuthEnvelope& envelope, float baselineY, bool baselineStable, int changedColumns, int period) {
+    if (!config.enabled) return false;
+
+    if (!roi.empty()) {
+        // A pick reached the border, a probe frame shows one outside the region, or time for the periodic
+        // check: learn again on full frames
+        bool refresh = config.refreshEvery > 0 && frameIndex - learnedAt >= config.refreshEvery;
+        bool probe = processed.area() == frameSize.area() && foregroundOutside(tops);
+        if (refresh || probe || (changedColumns > 0 && touchesBorder(envelope, frameSize))) {
+            relearn();
+            return true;
+        }
+        return false;
+    }
+
+    // Learning: one drum rotation of full frames on a stable baseline
+    if (!baselineStable) {
+        learnStart = -1;
+        return false;
+    }
+    if (learnStart == -1) learnStart = frameIndex;
+    long long window = period > 0 ? period : config.learnFrames;
+    if (frameIndex - learnStart < window) return false;
+
+    roi = learn(envelope, baselineY, frameSize);
+    learnedAt = frameIndex;
+    learnStart = -1;
+    return !roi.empty();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include "AzimuthEnvelope.h"
+#include <vector>
+
+// ------- DRUM ROI ------- //
+// The picks only ever appear in one region of the frame: between the highest pick tip and the baseline,
+// and across the columns the drum turns in. The region is learned on full frames over the first drum
+// rotation once the baseline is stable (the rotation period when known, else learnFrames): the rows
+// from the top of the accumulated envelope down to the baseline cutoff and the columns the envelope
+// covers, plus a margin. After that the per-frame kernels (gray conversion, baseline detection, blur,
+// pick mask, contours) only process that region.
+//
+// The region is learned again on full frames when the envelope reaches its border (a pick grew out of it),
+// when the envelope is rebuilt with new trackbar values and every refreshEvery frames. A pick entirely
+// outside the region never reaches its border: every probeEvery-th frame is therefore processed whole, and
+// foreground outside the region on such a probe frame starts a new learning pass as well.
+
+struct DrumRoiConfig {
+    bool enabled = true;              // --no-roi : process the full frame
+    int margin = 16;                  // Native px added around the learned region
+    int learnFrames = 600;            // Learning frames while the period is unknown (ConvergenceConfig::maxPeriod)
+    long long refreshEvery = 9000;    // --roi-refresh N : frames between two learning passes (0 = never)
+    int probeEvery = 300;             // --roi-probe N : whole frame every N-th frame while the region is set (0 = never)
+};
+
+class DrumRoi {
+public:
+    explicit DrumRoi(const DrumRoiConfig& config = DrumRoiConfig());
+
+    // One consumed frame in decode order, after its merge: tops / processed are the frame's own top rows and
+    // the region its kernels processed, envelope / baselineY the accumulated state, changedColumns the
+    // envelope columns the frame moved, period the rotation period (0 = unknown).
+    // Returns true if region() changed.
+    bool observe(long long frameIndex, cv::Size frameSize, const std::vector<unsigned short>& tops, const cv::Rect& processed,
+                 const AzimuthEnvelope& envelope, float baselineY, bool baselineStable, int changedColumns, int period);
+    // Back to full frames and learn the region again (the envelope was rebuilt with new values)
+    void relearn();
+
+    // Region the kernels process; empty while learning (= the full frame)
+    const cv::Rect& region() const { return roi; }
+    // Processed region of a frame: region() or the full frame
+    cv::Rect processed(cv::Size frameSize) const;
+    // The same for the frame with this index: also the full frame on probe frames
+    cv::Rect processed(cv::Size frameSize, long long frameIndex) const;
+    // Whole-frame probe period while the region is set (0 = none)
+    int probeEvery() const { return config.enabled ? config.probeEvery : 0; }
+    // Share of the frame area the kernels process (1 while learning)
+    double coverage(cv::Size frameSize) const;
+
+private:
+    bool touchesBorder(const AzimuthEnvelope& envelope, cv::Size frameSize) const;
+    bool foregroundOutside(const std::vector<unsigned short>& tops) const;
+    cv::Rect learn(const AzimuthEnvelope& envelope, float baselineY, cv::Size frameSize) const;
+
+    DrumRoiConfig config;
+    cv::Rect roi;
+    long long learnStart = -1;        // First learning frame with a stable baseline (-1 = not yet)
+    long long learnedAt = 0;          // Frame the region was set at
+};
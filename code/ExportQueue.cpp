@@ -0,0 +1,88 @@
+#include "ExportQueue.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+ExportQueue::ExportQueue(const ExportOptions& options)
+    : config(options), pool(max(1, options.threads)) {
+    config.capacity = max(1, config.capacity);
+}
+
+ExportQueue::~ExportQueue() {
+    drain();
+}
+
+void ExportQueue::submit(const string& path, const Mat& image) {
+    {
+        unique_lock<std::mutex> lock(mutex);
+        slotFree.wait(lock, [this]() { return inFlight < config.capacity; });
+        ++inFlight;
+    }
+
+    pool.submit([this, path, image]() {
+        if (!write(path, image, config)) {
+            failed.fetch_add(1, memory_order_relaxed);
+            cerr << "Error: Cannot write " << path << endl;
+        }
+        {
+            lock_guard<std::mutex> lock(mutex);
+            --inFlight;
+        }
+        slotFree.notify_all();
+    });
+}
+
+void ExportQueue::drain() {
+    unique_lock<std::mutex> lock(mutex);
+    slotFree.wait(lock, [this]() { return inFlight == 0; });
+}
+
+string ExportQueue::extension(ExportFormat format) {
+    switch (format) {
+    case ExportFormat::Jpeg: return ".jpg";
+    case ExportFormat::WebP: return ".webp";
+    default: return ".png";
+    }
+}
+
+vector<int> ExportQueue::encodeParams(const ExportOptions& options) {
+    vector<int> encode;
+    if (options.quality < 0) {
+        // Lossless WebP by default; PNG and JPEG keep the OpenCV defaults
+        if (options.format == ExportFormat::WebP) encode = { IMWRITE_WEBP_QUALITY, 101 };
+        return encode;
+    }
+
+    switch (options.format) {
+    case ExportFormat::Jpeg:
+        encode = { IMWRITE_JPEG_QUALITY, min(options.quality, 100) };
+        break;
+    case ExportFormat::WebP:
+        encode = { IMWRITE_WEBP_QUALITY, max(options.quality, 1) };
+        break;
+    default:
+        encode = { IMWRITE_PNG_COMPRESSION, min(options.quality, 9) };
+        break;
+    }
+    return encode;
+}
+
+bool ExportQueue::write(const string& path, const Mat& image, const ExportOptions& options) {
+    try {
+        return imwrite(path, image, encodeParams(options));
+    }
+    catch (const cv::Exception&) {
+        return false;   // e.g. OpenCV built without the encoder of the format
+    }
+}
+
+bool ExportQueue::parseFormat(const string& name, ExportFormat& format) {
+    if (name == "png") format = ExportFormat::Png;
+    else if (name == "jpg" || name == "jpeg") format = ExportFormat::Jpeg;
+    else if (name == "webp") format = ExportFormat::WebP;
+    else if (name == "svg") format = ExportFormat::Svg;
+    else return false;
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TaskPool.h"
+
+// ------- IMAGE EXPORT QUEUE ------- //
+// Encoding the 4x resampled frame is the slowest single step of an analysis. The export queue takes the
+// finished image and encodes + writes it on a few encoder threads of its own, so neither the GUI nor the
+// analysis workers wait for the encoder. The queue is bounded: when the encoders fall behind, submit()
+// waits for a free slot instead of piling up frames in memory.
+
+enum class ExportFormat {
+    Png,        // Lossless, compression level 0-9
+    Jpeg,       // Quality 0-100
+    WebP,       // Quality 1-100, above 100 lossless
+    Svg         // Native frame (PNG) + vector overlay instead of the resampled raster
+};
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Png;   // --format png|jpg|webp|svg
+    int quality = -1;                          // --quality : PNG level / JPEG or WebP quality (-1 = format default)
+    int rasterScale = 0;                       // --raster-scale : upsampling of the annotated raster (0 = measurement scale)
+    int threads = 2;                           // --export-threads : encoder threads
+    int capacity = 16;                         // --export-queue : images queued or encoding at most
+};
+
+class ExportQueue {
+public:
+    explicit ExportQueue(const ExportOptions& options);
+    // Writes everything still queued
+    ~ExportQueue();
+
+    ExportQueue(const ExportQueue&) = delete;
+    ExportQueue& operator=(const ExportQueue&) = delete;
+
+    const ExportOptions& options() const { return config; }
+
+    // Queues the image for encoding to path; waits while the queue is full. The image must not be
+    // modified afterwards (a shared Mat header is enough).
+    void submit(const std::string& path, const cv::Mat& image);
+    // Waits until every submitted image is written
+    void drain();
+    // Images that could not be written so far
+    long long failures() const { return failed.load(std::memory_order_relaxed); }
+    // Counts a failed write done outside the queue (the SVG overlay next to a queued native frame)
+    void countFailure() { failed.fetch_add(1, std::memory_order_relaxed); }
+
+    // File extension of the raster output of a format (".png" for the native frame of Svg)
+    static std::string extension(ExportFormat format);
+    // imwrite parameters of the format and quality
+    static std::vector<int> encodeParams(const ExportOptions& options);
+    // Synchronous encode + write with the options (used by the encoder threads and without a queue)
+    static bool write(const std::string& path, const cv::Mat& image, const ExportOptions& options);
+    // "png" / "jpg" / "jpeg" / "webp" / "svg"; false for anything else
+    static bool parseFormat(const std::string& name, ExportFormat& format);
+
+private:
+    ExportOptions config;
+
+    std::mutex mutex;
+    std::condition_variable slotFree;   // An image finished (submit waits for a slot, drain for zero)
+    int inFlight = 0;                   // Queued + encoding
+    std::atomic<long long> failed{ 0 };
+
+    TaskPool pool;                      // Last member: its workers are joined before the rest goes away
+};
@@ -0,0 +1,377 @@
+#include "FrameAnalyzer.h"
+#include "FrameProcessing.h"
+#include "SpatialIndex.h"
+#include "SubpixelRefiner.h"
+#include <algorithm>           // for sort, abs
+#include <cmath>
+#include <cstdio>
+#include <numeric>             // for accumulate
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// Median of a non-empty list (mean of the two middle values for even sizes)
+int median(vector<int> values) {
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    if (n % 2 == 0)
+        return (values[n / 2 - 1] + values[n / 2]) / 2;
+    else
+        return values[n / 2];
+}
+
+// Sub-pixel value for the reports ("123.45")
+string formatPx(float value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", value);
+    return text;
+}
+
+} // namespace
+
+void FrameAnalyzer::findAzimuthPicks(AnalysisResult& result, const AnalyzerParams& params) {
+    const int scale = result.scale;
+    const int zoomedBaselineY = result.zoomedBaselineY();
+    const float baselineY = result.baselineY;
+
+    for (const auto& contour : result.azimuthContour) {
+        // Scale approximated poly corner point
+        vector<Point> redCirclePoints;
+        for (const auto& pt : AzimuthEnvelope::corners(contour, baselineY, params.epsilonFactor)) {
+            redCirclePoints.push_back(pt * scale);  // Store the red dot position
+        }
+
+        // Filter close red dots to retain only the highest one (smallest y) in each horizontal neighborhood
+        // Red dots within 80px of each other are considered overlapping candidates
+        vector<bool> replaced(redCirclePoints.size(), false);
+        XSortedIndex byX(redCirclePoints);
+        vector<int> neighbors;
+
+        // Loop through each red circle point
+        for (size_t i = 0; i < redCirclePoints.size(); ++i) {
+            if (replaced[i]) continue; // Skip if already replaced
+
+            Point pt1 = redCirclePoints[i];  // Current red circle point
+
+            // Compare pt1 with the points after it that are horizontally close within 80 px
+            byX.window(pt1.x, params.neighborhood, static_cast<int>(i), neighbors);
+            for (int j : neighbors) {
+                if (replaced[j]) continue;
+
+                Point pt2 = redCirclePoints[j];
+
+                // If both points are horizontally close, keep the one higher on frame
+                if (pt1.y < pt2.y) {
+                    replaced[j] = true; // if pt1 is higher (smaller y), keep pt1, discard pt2
+                }
+                else {
+                    replaced[i] = true; // if pt2 is higher, discard pt1
+                    break;  // Exit early since pt1 is no longer valid
+                }
+            }
+        }
+
+        // After filtering: record coordinates only final red dots
+        for (size_t i = 0; i < redCirclePoints.size(); ++i) {
+            if (!replaced[i]) {
+                PickMeasurement pick;
+                pick.position = redCirclePoints[i];
+                pick.height = zoomedBaselineY - redCirclePoints[i].y;
+                result.azimuthPicks.push_back(pick);
+            }
+        }
+    }
+}
+
+AnalysisResult FrameAnalyzer::analyze(const Mat& frame, const AzimuthEnvelope& envelope, float baselineY,
+                                      double timestampMs, const AnalyzerParams& params) {
+    AnalysisResult result;
+    result.timestampMs = timestampMs;
+    result.frameSize = frame.size();
+    result.baselineY = baselineY;
+    result.scale = params.scale;
+    const int scale = params.scale;
+    const int zoomedBaselineY = result.zoomedBaselineY();
+
+    // ------- AZIMUTH PICK TIP DETECTION START ------- //
+
+    // Azimuth contour: upper outline of everything the picks covered so far
+    result.azimuthContour = envelope.outline();
+    findAzimuthPicks(result, params);
+    // ------- AZIMUTH PICK TIP DETECTION END ------- //
+
+
+    // ------- PRELIMINARY CONTOUR + PICK AZIMUTH MATCHING START ------- //
+
+    // Step 1: Get pick tip coordinates from current frame (once per analysis)
+    vector<vector<Point>> pickContours;
+    Mat gray, binary;
+    cvtColor(frame, gray, COLOR_BGR2GRAY);
+    thresholdPickMask(gray, params.brightness, params.threshold, baselineCutoffRow(baselineY), binary);
+    findContours(binary, pickContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+    // Sub-pixel baseline of this frame; the red dots come from the whole-pixel envelope and are only
+    // converted to native units
+    result.refinedBaselineY = SubpixelRefiner::refineBaseline(gray, baselineY);
+    for (auto& pick : result.azimuthPicks) {
+        pick.refined = Point2f(pick.position) * (1.f / scale);
+        pick.refinedHeight = result.refinedBaselineY - pick.refined.y;
+    }
+
+    // Scan in horizontal blocks: highest scaled contour point per block in one pass over the points
+    result.pickTips = blockMinY(pickContours, scale, params.blockWidth, frame.cols * scale);
+
+    // Step 2: Match against red circles (nearest unused red dot within maxMatchDist)
+    vector<bool> usedRedIndices(result.azimuthPicks.size(), false);
+    vector<Point> redPositions;
+    for (const auto& pick : result.azimuthPicks) {
+        redPositions.push_back(pick.position);
+    }
+    GridIndex redGrid(redPositions, static_cast<int>(std::ceil(params.maxMatchDist)));
+
+    for (const Point& tip : result.pickTips) {
+        int bestIndex = redGrid.nearest(tip, params.maxMatchDist, usedRedIndices);
+
+        if (bestIndex != -1) {
+            PickMeasurement matched;
+            matched.position = tip;
+            matched.height = zoomedBaselineY - tip.y;
+            // The tip mask keeps gray values above threshold - brightness
+            matched.refined = SubpixelRefiner::refineTip(gray, Point(tip.x / scale, tip.y / scale),
+                                                         static_cast<float>(params.threshold - params.brightness));
+            matched.refinedHeight = result.refinedBaselineY - matched.refined.y;
+            result.matchedTips.push_back(matched);
+            usedRedIndices[bestIndex] = true;
+        }
+    }
+    // ------- PRELIMINARY CONTOUR + PICK AZIMUTH MATCHING END ------- //
+
+
+    estimateCuttingLines(result);
+    return result;
+}
+
+void FrameAnalyzer::estimateCuttingLines(AnalysisResult& result) {
+    // ------- CUTTING LINE STARTS ------- //
+
+    // Step 1: Extract sorted x-values from red circles
+    vector<int> xValues;
+    for (const auto& pick : result.azimuthPicks) {
+        xValues.push_back(pick.position.x);
+    }
+    sort(xValues.begin(), xValues.end());
+
+    // Step 2: Compute adjacent spacings
+    vector<int> spacings;
+    for (size_t i = 1; i < xValues.size(); ++i) {
+        spacings.push_back(xValues[i] - xValues[i - 1]);
+    }
+
+    if (!spacings.empty()) {
+        // Step 3: Compute Median
+        int medianSpacing = median(spacings);
+
+        // Step 4: Compute MAD (Median Absolute Deviation)
+        vector<int> absDeviations;
+        for (int s : spacings) {
+            absDeviations.push_back(abs(s - medianSpacing));
+        }
+        int mad = median(absDeviations);
+
+        // Step 5: Filter spacings using MAD threshold
+        int madThreshold = 2 * mad;
+        for (int s : spacings) {
+            if (abs(s - medianSpacing) <= madThreshold) {
+                result.filteredSpacings.push_back(s);
+            }
+        }
+
+        // Step 6: Compute average spacing from filtered values
+        int sum = accumulate(result.filteredSpacings.begin(), result.filteredSpacings.end(), 0);
+        result.cuttingSpacing = result.filteredSpacings.empty() ? 0 : sum / static_cast<int>(result.filteredSpacings.size());
+
+        // Anchor the cutting lines at the median red circle
+        result.cuttingAnchorX = xValues[xValues.size() / 2];
+    }
+    // ----- CUTTING LINE ENDS ------- //
+}
+
+Overlay FrameAnalyzer::overlay(const AnalysisResult& result) {
+    Overlay overlay;
+    const float scale = static_cast<float>(result.scale);
+    const int zoomedCols = result.frameSize.width * result.scale;
+    const int zoomedRows = result.frameSize.height * result.scale;
+
+    // Zoomed px -> native px (measurements are stored in zoomed coordinates)
+    auto native = [scale](Point pt) { return Point2f(pt.x / scale, pt.y / scale); };
+
+    // ------- AZIMUTH CONTOUR BUILD START ------- //
+
+    // Blue contour only between the top 10% and the baseline and away from the left/right border
+    if (result.baselineY != -1) {
+        Rect2f visible(5 / scale, result.frameSize.height * 0.1f,
+                       (zoomedCols - 13) / scale, result.baselineY - result.frameSize.height * 0.1f);
+        for (const auto& contour : result.azimuthContour) {
+            vector<Point2f> points(contour.begin(), contour.end());
+            overlay.clippedPolyline(points, visible, Scalar(255, 0, 0), 2);
+        }
+
+        for (const auto& pick : result.azimuthPicks) {
+            const Point& pt = pick.position;
+
+            // Draw red circle
+            overlay.circle(native(pt), 4, Scalar(0, 0, 255), FILLED);  // Red dot
+
+            // Coordinate label
+            string coordText = "(" + to_string(pt.x) + "," + to_string(zoomedRows - pt.y) + ")";
+            Point2f offset(5, -5);
+
+            if (pt.x > zoomedCols - 100) {
+                offset = Point2f(-70, 15);   // move left if near right edge
+            }
+
+            overlay.text(coordText, native(pt), offset, FONT_HERSHEY_PLAIN, 0.9, Scalar(255, 255, 255), 1);
+
+            // Height label (placed slightly below the coordinate label)
+            string heightText = "H: " + to_string(pick.height) + "px";
+            overlay.text(heightText, native(pt), offset + Point2f(0, 12), FONT_HERSHEY_PLAIN, 0.9, Scalar(180, 180, 255), 1);
+        }
+    }
+
+    for (const auto& matched : result.matchedTips) {
+        const Point& tip = matched.position;
+
+        // Yellow circle
+        overlay.circle(native(tip), 6, Scalar(0, 255, 255), 2);
+
+        // Create coordinate text
+        string coordText2 = "(" + to_string(tip.x) + "," + to_string(zoomedRows - tip.y) + ")";
+        Point2f offset(5, -30);
+
+        if (tip.x > zoomedCols - 100) {
+            offset = Point2f(-70, -30);   // move left if near right edge
+        }
+
+        overlay.text(coordText2, native(tip), offset, FONT_HERSHEY_PLAIN, 0.9, Scalar(0, 255, 255), 1);
+
+        string heightText = "True Pick Height: " + to_string(matched.height) + " px";
+        overlay.text(heightText, native(tip), offset + Point2f(0, 80), FONT_HERSHEY_PLAIN, 0.9, Scalar(127, 0, 255), 1);
+
+
+        // PRELIMINARY SEMI-TRIANGULAR CONTOURS
+
+        // Define triangle below the tip (sizes in zoomed px)
+        int triHeight = 300;  // vertical size
+        int triWidth = 400;   // horizontal base width
+
+        Point pt1 = tip;  // tip of triangle
+        Point pt2(tip.x - triWidth / 2, tip.y + triHeight);
+        Point pt3(tip.x + triWidth / 2, tip.y + triHeight);
+
+        overlay.polyline({ native(pt1), native(pt2), native(pt3) }, true, Scalar(255, 0, 255), 2);  // Pink triangle (BGR)
+    }
+
+    // Add label for azimuth contour line
+    overlay.text("Azimuth Contour Line", Point2f(0, 0), Point2f(10, 100), FONT_HERSHEY_SIMPLEX, 0.9, Scalar(255, 0, 0), 2);
+
+    // ------- AZIMUTH CONTOUR BUILD END ------- //
+
+    // ------- CUTTING LINE STARTS ------- //
+
+    // Draw vertical cutting lines using the average spacing, anchored at median red circle
+    if (result.azimuthPicks.size() >= 2 && result.cuttingSpacing > 0) {
+        int xStart = result.cuttingAnchorX;
+        int averageSpacing = result.cuttingSpacing;
+        float bottom = static_cast<float>(result.frameSize.height);
+
+        vector<int> cuttingX;
+        // Vertical dashed lines to the left of the anchor
+        for (int x = xStart - averageSpacing; x >= 0; x -= averageSpacing) cuttingX.push_back(x);
+        // Vertical dashed lines to the right of the anchor (including anchor itself)
+        for (int x = xStart; x < zoomedCols; x += averageSpacing) cuttingX.push_back(x);
+
+        for (int x : cuttingX) {
+            overlay.line(Point2f(x / scale, 0), Point2f(x / scale, bottom), Scalar(200, 200, 0), 1, true);  // Yellow dashed line
+            overlay.text(to_string(x), Point2f(x / scale, 0), Point2f(2, 20), FONT_HERSHEY_PLAIN, 0.8, Scalar(200, 200, 0), 1);
+        }
+
+        // Cutting lines now divide the frame at regular horizontal intervals
+    }
+
+    // ----- CUTTING LINE ENDS ------- //
+
+
+    // ------- BASE LINE PLOT START ------- //
+
+    // If the fixed baseline was detected earlier, draw it
+    if (result.baselineY != -1) {
+        int zoomedBaselineY = result.zoomedBaselineY(); // Scale the baseline for zoomed image
+        float y = zoomedBaselineY / scale;
+
+        overlay.line(Point2f(0, y), Point2f(static_cast<float>(result.frameSize.width), y), Scalar(0, 255, 255), 5); // Draw yellow baseline
+        string label = "Baseline: " + to_string(zoomedRows - zoomedBaselineY) + " px from bottom";
+        overlay.text(label, Point2f(0, y), Point2f(10, -10), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 255), 2);
+    }
+
+    // ------- BASE LINE PLOT END ------- //
+
+    return overlay;
+}
+
+Mat FrameAnalyzer::annotate(const Mat& frame, const AnalysisResult& result) {
+    // One upsample of the frame, everything else is drawn as vectors at the zoomed resolution
+    return overlay(result).render(frame, result.scale);
+}
+
+void FrameAnalyzer::printMeasurements(const AnalysisResult& result, ostream& console, ostream& file) {
+    int timestamp_sec = result.timestampSec();
+
+    if (result.baselineY != -1) {
+        console << "\n[AZIMUTH] Pick Count, X-position and Height in Azimuth Contour:\n\n";
+        console << "  Azimuth Pick Count in Video: " << result.azimuthPicks.size() << endl;
+
+        file << "[AZIMUTH] Pick Count, X-position and Height in Azimuth Contour:\n\n";
+        file << "  Azimuth Pick Count in Video: " << result.azimuthPicks.size() << endl;
+
+        for (const auto& pick : result.azimuthPicks) {
+            console << "  Azimuth Pick at x-position " << pick.position.x << " px with Pick Height: " << pick.height << " px\n";
+            file << "  Azimuth Pick at x-position " << pick.position.x << " px with Pick Height: " << pick.height << " px\n";
+        }
+    }
+
+    if (!result.matchedTips.empty()) {
+        console << "\n[AZIMUTH] Pick(s) in Azimuth at timeframe " << timestamp_sec << "s:\n" << endl;
+        console << "  Azimuth Pick Count in this Frame: " << result.matchedTips.size() << endl;
+
+        file << "\n[AZIMUTH] Pick(s) in Azimuth timeframe " << timestamp_sec << "s:\n" << endl;
+        file << "  Azimuth Pick Count in this Frame: " << result.matchedTips.size() << endl;
+        for (const auto& matched : result.matchedTips) {
+            // Sub-pixel values in zoomed px like the whole-pixel ones, native px in brackets
+            string subpixel = " (sub-pixel: x " + formatPx(result.zoomed(matched.refined.x)) + " [" + formatPx(matched.refined.x) +
+                              "], height " + formatPx(result.zoomed(matched.refinedHeight)) + " [" + formatPx(matched.refinedHeight) + "] px)";
+            console << "  Azimuth Pick at x-position " << matched.position.x << " px with Pick Height: " << matched.height << " px" << subpixel << endl;
+            file << "  Azimuth Pick at x-position " << matched.position.x << " px with Pick Height: " << matched.height << " px" << subpixel << endl;
+        }
+    }
+    else {
+        console << "\n[AZIMUTH] No picks aligned with azimuth at frame " << timestamp_sec << "s.\n";
+        file << "\n[AZIMUTH] No picks aligned with azimuth at frame " << timestamp_sec << "s.\n";
+    }
+
+    console << "\nFiltered Spacings: ";
+    for (int s : result.filteredSpacings) console << s << " ";
+    console << "\nEstimated Cutting Line Distance: " << result.cuttingSpacing << " px\n";
+    file << "\nEstimated Cutting Line Distance: " << result.cuttingSpacing << " px\n";
+
+    if (result.baselineY == -1) {
+        console << "Baseline not available!" << endl;
+    }
+    else {
+        string baseline = "Sub-pixel Baseline: " + formatPx(result.zoomed(result.refinedBaselineY)) + " [" +
+                          formatPx(result.refinedBaselineY) + "] px from top\n";
+        console << baseline;
+        file << baseline;
+    }
+}
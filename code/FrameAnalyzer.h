@@ -0,0 +1,75 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AzimuthEnvelope.h"
+#include "OverlayRenderer.h"
+
+// ------- FRAME ANALYZER ------- //
+// The click analysis as a reusable function: takes a frame, a snapshot of the accumulated state and the
+// parameters, and returns the measurements. It touches no globals, so several analyses can run at once
+// on worker threads while the GUI keeps playing.
+
+struct AnalyzerParams {
+    int brightness = 11;              // Brightness offset used for the pick tip mask
+    int threshold = 101;              // Binary threshold used for the pick tip mask
+    int scale = 4;                    // Resampling factor of the reported (zoomed) coordinates
+    double epsilonFactor = 0.0025;    // approxPolyDP tolerance per contour length (smaller = more detail)
+    int neighborhood = 80;            // Red dots closer than this (zoomed px) keep only the highest one
+    int blockWidth = 500;             // Width of each horizontal pick tip scan block (zoomed px)
+    double maxMatchDist = 50.0;       // Max distance (zoomed px) between a pick tip and a red dot
+};
+
+// A measured point in zoomed coordinates with its height above the baseline, plus its sub-pixel
+// refinement in native coordinates (zoomed = native * scale)
+struct PickMeasurement {
+    cv::Point position;
+    int height = 0;                   // Zoomed px above the baseline
+    cv::Point2f refined;              // Sub-pixel position (native px)
+    float refinedHeight = 0.f;        // Native px above the refined baseline
+};
+
+struct AnalysisResult {
+    double timestampMs = 0.0;
+    cv::Size frameSize;               // Native frame size
+    float baselineY = -1;             // Fixed baseline (native px), -1 if not available
+    float refinedBaselineY = -1;      // Sub-pixel baseline in this frame (native px), -1 if not available
+    int scale = 4;
+
+    std::vector<std::vector<cv::Point>> azimuthContour;  // Upper outline runs (native px)
+    std::vector<PickMeasurement> azimuthPicks;           // Filtered red dots (zoomed px)
+    std::vector<cv::Point> pickTips;                     // Highest tip per scan block (zoomed px)
+    std::vector<PickMeasurement> matchedTips;            // Tips in azimuth (zoomed px)
+
+    std::vector<int> filteredSpacings;                   // Red dot spacings kept by the MAD filter
+    int cuttingSpacing = 0;                              // Estimated cutting line distance (zoomed px)
+    int cuttingAnchorX = -1;                             // x of the median red dot (zoomed px)
+
+    int timestampSec() const { return static_cast<int>(timestampMs / 1000.0); }
+    int zoomedBaselineY() const { return static_cast<int>(baselineY * scale); }
+    // Native px -> zoomed px as float (no rounding)
+    float zoomed(float nativeValue) const { return nativeValue * scale; }
+};
+
+class FrameAnalyzer {
+public:
+    // Azimuth picks, pick tips in azimuth and cutting line spacing of a BGR frame
+    static AnalysisResult analyze(const cv::Mat& frame, const AzimuthEnvelope& envelope, float baselineY,
+                                  double timestampMs, const AnalyzerParams& params);
+
+    // The two steps of analyze that only need the accumulated state, for per-frame callers (PickTracker):
+    // red dots of result.azimuthContour (with result.baselineY / scale set) into result.azimuthPicks, and
+    // the cutting line spacing and anchor of those red dots
+    static void findAzimuthPicks(AnalysisResult& result, const AnalyzerParams& params);
+    static void estimateCuttingLines(AnalysisResult& result);
+
+    // Azimuth contour, red dots, matched tips, cutting lines and baseline as vector primitives
+    static Overlay overlay(const AnalysisResult& result);
+
+    // The resampled frame with the overlay drawn on it
+    static cv::Mat annotate(const cv::Mat& frame, const AnalysisResult& result);
+
+    // Measurement report: the full report goes to console, the measurement file lines to file
+    static void printMeasurements(const AnalysisResult& result, std::ostream& console, std::ostream& file);
+};
@@ -0,0 +1,277 @@
+#include "FramePipeline.h"
+#include "AzimuthEnvelope.h"
+#include "FrameProcessing.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// Spin briefly, then yield, then sleep: keeps hand-off latency low without burning a core while idle
+class Backoff {
+public:
+    void pause() {
+        if (spins < 64) {
+            ++spins;
+        }
+        else if (spins < 128) {
+            ++spins;
+            this_thread::yield();
+        }
+        else {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+    void reset() { spins = 0; }
+
+private:
+    int spins = 0;
+};
+
+} // namespace
+
+FramePipeline::FramePipeline(VideoCapture& capture, const PipelineConfig& pipelineConfig)
+    : ownSource(new VideoFileSource(capture, pipelineConfig.lumaDecode)), source(*ownSource), config(pipelineConfig) {
+    createRings();
+}
+
+FramePipeline::FramePipeline(FrameSource& frameSource, const PipelineConfig& pipelineConfig)
+    : source(frameSource), config(pipelineConfig) {
+    createRings();
+}
+
+void FramePipeline::createRings() {
+    int workers = config.workers;
+    if (workers <= 0) {
+        workers = max(1, static_cast<int>(thread::hardware_concurrency()) - 2);
+    }
+    size_t capacity = static_cast<size_t>(max(1, config.ringCapacity));
+    for (int i = 0; i < workers; ++i) {
+        rings.emplace_back(new StageRing<FramePacket>(capacity));
+    }
+    // At most one entry per frame in flight plus the one in effect: publishing never allocates
+    settings.reserve(workers * capacity + 2);
+    settings.push_back(FrameSettings());
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+}
+
+void FramePipeline::start() {
+    threads.emplace_back(&FramePipeline::decodeLoop, this);
+    for (int i = 0; i < workerCount(); ++i) {
+        threads.emplace_back(&FramePipeline::workerLoop, this, i);
+    }
+}
+
+void FramePipeline::stop() {
+    stopping = true;
+    source.interrupt();   // A decoder waiting for a stream producer gives up
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+    threads.clear();
+}
+
+void FramePipeline::setParameters(int brightnessValue, int thresholdValue) {
+    brightness.store(brightnessValue, memory_order_relaxed);
+    threshold.store(thresholdValue, memory_order_relaxed);
+}
+
+void FramePipeline::publishBaseline(float baseline, bool stable) {
+    baselineY.store(baseline, memory_order_relaxed);
+    FrameSettings latest;
+    {
+        lock_guard<std::mutex> lock(settingsMutex);
+        latest = settings.back();
+    }
+    if (latest.baselineStable == stable) return;
+    latest.baselineStable = stable;
+    schedule(latest);
+}
+
+void FramePipeline::publishRoi(const Rect& roi, int probeEvery) {
+    FrameSettings latest;
+    {
+        lock_guard<std::mutex> lock(settingsMutex);
+        latest = settings.back();
+    }
+    if (latest.roi == roi && latest.probeEvery == probeEvery) return;
+    latest.roi = roi;
+    latest.probeEvery = probeEvery;
+    schedule(latest);
+}
+
+void FramePipeline::schedule(const FrameSettings& changed) {
+    // Frame nextIndex + slots is dealt to a ring only after the consumer released nextIndex, so no worker
+    // has started on it yet
+    size_t slots = 0;
+    for (const auto& ring : rings) slots += ring->capacity();
+    const long long from = nextIndex + static_cast<long long>(slots);
+
+    lock_guard<std::mutex> lock(settingsMutex);
+    // Entries superseded before the consumer position are no longer needed by any worker
+    while (settings.size() > 1 && settings[1].from <= nextIndex) settings.erase(settings.begin());
+    if (settings.back().from == from) settings.back() = changed;
+    else settings.push_back(changed);
+    settings.back().from = from;
+}
+
+FramePipeline::FrameSettings FramePipeline::settingsFor(long long frameIndex) {
+    lock_guard<std::mutex> lock(settingsMutex);
+    for (size_t i = settings.size(); i-- > 1;) {
+        if (settings[i].from <= frameIndex) return settings[i];
+    }
+    return settings.front();
+}
+
+void FramePipeline::setAnalysisCadence(int every) {
+    analysisEvery.store(max(1, every), memory_order_relaxed);
+}
+
+size_t FramePipeline::readyCount() const {
+    size_t ready = 0;
+    for (const auto& ring : rings) ready += ring->readyCount();
+    return ready;
+}
+
+bool FramePipeline::readFrame(Mat& frame, double& timestampMs) {
+    if (source.read(frame, timestampMs)) return true;
+
+    // If we reached the end of the video, loop back to the start
+    return config.loopVideo && source.rewind() && source.read(frame, timestampMs);
+}
+
+void FramePipeline::decodeLoop() {
+    long long index = 0;
+    Backoff backoff;
+
+    while (!stopping) {
+        StageRing<FramePacket>& ring = *rings[index % rings.size()];
+        FramePacket* slot = ring.acquireFree();
+
+        if (!slot) {
+            if (config.policy == BackpressurePolicy::DropNewest) {
+                if (!source.skip() && !(config.loopVideo && source.rewind() && source.skip())) break;
+                dropped.fetch_add(1, memory_order_relaxed);
+                if (config.telemetry) config.telemetry->count(Counter::FramesDropped);
+            }
+            else {
+                backoff.pause();
+            }
+            continue;
+        }
+        backoff.reset();
+
+        {
+            ScopedTimer timer(config.telemetry, Stage::Decode);
+            if (!readFrame(slot->frame, slot->timestampMs)) break;
+        }
+        if (config.telemetry) config.telemetry->count(Counter::FramesDecoded);
+        slot->index = index++;
+        ring.publishDecoded();
+    }
+
+    decodedTotal.store(index, memory_order_release);
+    decoderDone.store(true, memory_order_release);
+}
+
+void FramePipeline::workerLoop(int worker) {
+    StageRing<FramePacket>& ring = *rings[worker];
+    Backoff backoff;
+
+    while (!stopping) {
+        FramePacket* packet = ring.acquireDecoded();
+        if (!packet) {
+            // Decoder finished and everything it dealt to this ring is analyzed
+            if (decoderDone.load(memory_order_acquire) && !ring.acquireDecoded()) break;
+            backoff.pause();
+            continue;
+        }
+        backoff.reset();
+
+        analyze(*packet);
+        ring.publishAnalyzed();
+    }
+}
+
+void FramePipeline::analyze(FramePacket& packet) {
+    // Monitoring cadence: frames between the samples are only displayed
+    int every = analysisEvery.load(memory_order_relaxed);
+    packet.analyzed = every <= 1 || packet.index % every == 0;
+    if (!packet.analyzed) {
+        packet.detectedY = -1;
+        packet.contours.clear();
+        if (config.telemetry) config.telemetry->count(Counter::AnalysisSkipped);
+        return;
+    }
+
+    packet.brightness = brightness.load(memory_order_relaxed);
+    packet.threshold = threshold.load(memory_order_relaxed);
+
+    // Drum region in effect for this frame, the whole frame while it is learned
+    const FrameSettings frameSettings = settingsFor(packet.index);
+    const Rect frameRect(0, 0, packet.frame.cols, packet.frame.rows);
+    Rect roi = frameSettings.roi & frameRect;
+    if (roi.empty()) roi = frameRect;
+    // Probe frame: the whole frame, so picks outside the region are seen (the first analyzed frame from
+    // each multiple of the period on, whatever the cadence)
+    if (frameSettings.probeEvery > 0 && packet.index % frameSettings.probeEvery < every) roi = frameRect;
+    clearOutsideRegion(packet.frame.size(), roi, packet.roi, packet.gray, packet.binary);
+
+    // ------- BASELINE DETECTION PER FRAME ------- //
+    bool detect = BaselineDetector::shouldDetect(config.baseline, packet.index, frameSettings.baselineStable);
+    const bool coarse = config.pyramid.levels > 0;
+    {
+        ScopedTimer timer(config.telemetry, Stage::Baseline);
+        packet.detectedY = coarse ? packet.pyramid.detectBaselineRow(packet.frame, detect, roi, config.pyramid)
+                                  : detectBaselineRow(packet.frame, packet.gray, detect, roi);
+    }
+
+    // The published baseline may lag a few frames behind; combining it with this frame's own candidate
+    // never masks more rows than the in-order merge will, and the consumer trims the rest.
+    float baseline = baselineY.load(memory_order_relaxed);
+    if (packet.detectedY != -1 && (baseline == -1 || packet.detectedY < baseline)) {
+        baseline = baselineFromRow(packet.detectedY);
+    }
+    packet.maskCutoff = baselineCutoffRow(baseline);
+
+    // ------- CONTOUR DETECTION PER FRAME ------- //
+    {
+        ScopedTimer timer(config.telemetry, Stage::Mask);
+        fill(packet.tops.begin(), packet.tops.end(), AzimuthEnvelope::kEmpty);
+        if (coarse) packet.pyramid.pickMask(packet.brightness, packet.threshold, packet.maskCutoff, packet.gray, packet.binary, packet.tops);
+        else fusedPickMask(packet.gray, packet.brightness, packet.threshold, packet.maskCutoff, packet.binary, packet.tops, roi);
+    }
+
+    if (config.computeContours) {
+        ScopedTimer timer(config.telemetry, Stage::Contours);
+        findContours(packet.binary(roi), packet.contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE, roi.tl());
+    }
+}
+
+FramePacket* FramePipeline::next() {
+    StageRing<FramePacket>& ring = *rings[nextIndex % rings.size()];
+    Backoff backoff;
+
+    while (!stopping) {
+        FramePacket* packet = ring.acquireAnalyzed();
+        if (packet) return packet;
+
+        if (decoderDone.load(memory_order_acquire) && nextIndex >= decodedTotal.load(memory_order_acquire)) {
+            return nullptr;
+        }
+        backoff.pause();
+    }
+    return nullptr;
+}
+
+void FramePipeline::release() {
+    source.returnFrame();
+    rings[nextIndex % rings.size()]->releaseConsumed();
+    ++nextIndex;
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include "BaselineDetector.h"
+#include "FrameSource.h"
+#include "PyramidRefiner.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Telemetry;
+
+// ------- STAGED FRAME PIPELINE ------- //
+// decoder thread -> N analysis workers -> consumer (accumulation + display on the calling thread)
+//
+// The decoder reads from a FrameSource: a video file, or a raw frame stream of a capture process.
+//
+// Every worker owns one bounded ring of FramePackets. The decoder deals frames round-robin into the
+// rings and the consumer drains them in the same round-robin order, so frames leave the pipeline in
+// decode order even with several workers. A packet never moves: the decoder decodes into the slot,
+// the worker analyzes it in place and the consumer hands it back, so all Mats are reused.
+
+// One frame travelling through the pipeline
+struct FramePacket {
+    long long index = 0;              // Decode order (0, 1, 2, ...)
+    double timestampMs = 0.0;         // CAP_PROP_POS_MSEC of the frame (capture time of stream frames)
+    cv::Mat frame;                    // Decoded BGR frame (gray from a gray stream; may point into the source until released)
+
+    // Filled by the analysis worker
+    bool analyzed = true;             // false = skipped by the analysis cadence (decoded for display only)
+    int brightness = 0;               // Trackbar values the mask was computed with
+    int threshold = 0;
+    int detectedY = -1;               // Baseline candidate of this frame (detectBaselineRow)
+    int maskCutoff = -1;              // Baseline cutoff the worker masked binary with
+    cv::Rect roi;                     // Region the worker processed (drum ROI or the whole frame)
+    cv::Mat gray;                     // Blurred grayscale (zero outside roi; pyramid mode: only the refinement windows)
+    cv::Mat binary;                   // Masked pick binary (zero outside roi)
+    std::vector<unsigned short> tops; // Topmost foreground row per column of binary (AzimuthEnvelope::kEmpty = none)
+    std::vector<std::vector<cv::Point>> contours; // Pick contours of binary (if enabled)
+    PyramidRefiner pyramid;           // Coarse-to-fine working set (pyramid mode, scale() > 1)
+};
+
+// Lock-free bounded ring with three single-writer cursors: decoded (producer), analyzed (worker) and
+// consumed (consumer). Slots between the cursors belong to exactly one stage at a time.
+template <typename T>
+class StageRing {
+public:
+    explicit StageRing(size_t capacity) : slots(capacity) {}
+
+    size_t capacity() const { return slots.size(); }
+
+    // Producer: free slot to decode into, nullptr if the ring is full
+    T* acquireFree() {
+        size_t h = decoded.load(std::memory_order_relaxed);
+        if (h - consumed.load(std::memory_order_acquire) >= slots.size()) return nullptr;
+        return &slots[h % slots.size()];
+    }
+    void publishDecoded() { decoded.store(decoded.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Worker: next decoded slot, nullptr if none is waiting
+    T* acquireDecoded() {
+        size_t m = analyzed.load(std::memory_order_relaxed);
+        if (m == decoded.load(std::memory_order_acquire)) return nullptr;
+        return &slots[m % slots.size()];
+    }
+    void publishAnalyzed() { analyzed.store(analyzed.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: next analyzed slot, nullptr if none is ready
+    T* acquireAnalyzed() {
+        size_t t = consumed.load(std::memory_order_relaxed);
+        if (t == analyzed.load(std::memory_order_acquire)) return nullptr;
+        return &slots[t % slots.size()];
+    }
+    void releaseConsumed() { consumed.store(consumed.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Number of analyzed slots waiting for the consumer (approximate when read from another thread)
+    size_t readyCount() const {
+        return analyzed.load(std::memory_order_acquire) - consumed.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    // Each cursor is written by a different thread: keep them on separate cache lines
+    char pad0[64];
+    std::atomic<size_t> decoded{ 0 };
+    char pad1[64];
+    std::atomic<size_t> analyzed{ 0 };
+    char pad2[64];
+    std::atomic<size_t> consumed{ 0 };
+};
+
+// What the decoder does when the next worker ring is full
+enum class BackpressurePolicy {
+    Block,      // Wait for a free slot (file input: every frame is analyzed; a stream producer is held back)
+    DropNewest  // Keep reading and discard the frame (live input: never fall behind the source)
+};
+
+struct PipelineConfig {
+    int workers = 0;                  // Analysis worker threads, 0 = hardware concurrency - 2 (min 1)
+    int ringCapacity = 3;             // Slots per worker ring
+    BackpressurePolicy policy = BackpressurePolicy::Block;
+    bool loopVideo = true;            // Seek back to frame 0 at the end (interactive playback)
+    bool computeContours = true;      // Per-frame pick contours for display (not needed headless)
+    bool lumaDecode = false;          // --luma : video frames as the decoder's Y plane, no BGR conversion
+    PyramidConfig pyramid;            // --pyramid N : baseline and pick mask coarse-to-fine
+    BaselineDetectorConfig baseline;  // Baseline detection cadence once the baseline is stable
+    Telemetry* telemetry = nullptr;   // Decode / worker stage timers and frame counters (optional)
+};
+
+class FramePipeline {
+public:
+    FramePipeline(cv::VideoCapture& capture, const PipelineConfig& config);
+    // Frames of any source; loopVideo needs a source that can rewind
+    FramePipeline(FrameSource& source, const PipelineConfig& config);
+    ~FramePipeline();
+
+    // Starts the decoder and worker threads. The capture / source must not be used by the caller afterwards.
+    void start();
+    void stop();
+
+    // Consumer side (one thread): blocks until the next packet in decode order is analyzed.
+    // Returns nullptr once the video is finished (loopVideo = false) or the pipeline is stopped.
+    FramePacket* next();
+    // Hands the packet from next() back to the decoder (and its frame back to the source)
+    void release();
+
+    // Values the workers use for the next frames they analyze
+    void setParameters(int brightness, int threshold);
+    // Latest merged baseline, used by the workers to mask below it (-1 = none yet), and whether it is
+    // stable enough to detect only on every baseline.everyK-th frame
+    void publishBaseline(float baselineY, bool stable);
+    // Drum region the workers restrict the per-frame kernels to (empty = the whole frame); every
+    // probeEvery-th frame (the first analyzed one from each multiple on) is still processed whole
+    void publishRoi(const cv::Rect& roi, int probeEvery = 0);
+    // A changed stability or region applies from a fixed frame index on: the first frame that cannot be in
+    // the rings yet (consumer position + ring slots of all workers). So every frame is processed with the
+    // same settings however far the workers ran ahead, and a run is reproducible.
+
+    // Analyze only every N-th frame (1 = all); the others are passed through for display with analyzed
+    // = false. Set by the consumer once the azimuth envelope has converged.
+    void setAnalysisCadence(int every);
+
+    // Analyzed packets waiting for the consumer
+    size_t readyCount() const;
+    // Frames discarded by the DropNewest policy
+    long long droppedFrames() const { return dropped.load(std::memory_order_relaxed); }
+    int workerCount() const { return static_cast<int>(rings.size()); }
+
+private:
+    void createRings();
+    void decodeLoop();
+    void workerLoop(int worker);
+    void analyze(FramePacket& packet);
+    bool readFrame(cv::Mat& frame, double& timestampMs);
+
+    // Worker settings published by the consumer, in effect for the frames from index `from` on
+    struct FrameSettings {
+        long long from = 0;
+        bool baselineStable = false;
+        cv::Rect roi;                 // Empty = the whole frame
+        int probeEvery = 0;           // Whole-frame probe period of the region
+    };
+    void schedule(const FrameSettings& settings);
+    FrameSettings settingsFor(long long frameIndex);
+
+    std::unique_ptr<FrameSource> ownSource;     // VideoFileSource of the capture constructor
+    FrameSource& source;
+    PipelineConfig config;
+    std::vector<std::unique_ptr<StageRing<FramePacket>>> rings;
+    std::vector<std::thread> threads;
+
+    std::atomic<bool> stopping{ false };
+    std::atomic<bool> decoderDone{ false };
+    std::atomic<long long> decodedTotal{ -1 };  // Frames decoded in total, set when the decoder ends
+    std::atomic<long long> dropped{ 0 };
+    std::atomic<int> brightness{ 0 };
+    std::atomic<int> threshold{ 0 };
+    std::atomic<float> baselineY{ -1 };
+    std::mutex settingsMutex;
+    std::vector<FrameSettings> settings;        // Ordered by from; the first entry covers the consumer position
+    std::atomic<int> analysisEvery{ 1 };
+    long long nextIndex = 0;                    // Consumer position (consumer thread only)
+};
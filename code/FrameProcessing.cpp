@@ -0,0 +1,198 @@
+#include "FrameProcessing.h"
+#include "AzimuthEnvelope.h"
+#include "BaselineDetector.h"
+#include <opencv2/core/hal/intrin.hpp>  // OpenCV universal intrinsics (SSE/AVX/NEON)
+#include <algorithm>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const int kMinStripeRows = 16;   // Fewer rows per thread are not worth a task
+
+// Mask of rows [startY, endY), columns [x0, x1): binary = 255 where gray >= level, tops[x - x0] lowered
+// to the first such row
+void maskRows(const Mat& gray, int startY, int endY, int x0, int x1, uchar level, Mat& binary, ushort* tops, bool useSimd) {
+    const int cols = x1 - x0;
+    for (int y = startY; y < endY; ++y) {
+        const uchar* src = gray.ptr<uchar>(y) + x0;
+        uchar* dst = binary.ptr<uchar>(y) + x0;
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        if (useSimd) {
+            const int lanes = VTraits<v_uint8>::vlanes();
+            const int half = VTraits<v_uint16>::vlanes();
+            v_uint8 threshold = vx_setall_u8(level);
+            v_uint16 row = vx_setall_u16(static_cast<ushort>(y));
+            v_uint16 none = vx_setall_u16(AzimuthEnvelope::kEmpty);
+            v_uint16 zero = vx_setzero_u16();
+            for (; x <= cols - lanes; x += lanes) {
+                v_uint8 mask = v_ge(vx_load(src + x), threshold);
+                v_store(dst + x, mask);
+                if (!v_check_any(mask)) continue;   // Background: most of the band
+
+                v_uint16 low, high;
+                v_expand(mask, low, high);
+                v_store(tops + x, v_min(vx_load(tops + x), v_select(v_ne(low, zero), row, none)));
+                v_store(tops + x + half, v_min(vx_load(tops + x + half), v_select(v_ne(high, zero), row, none)));
+            }
+            vx_cleanup();
+        }
+#endif
+        for (; x < cols; ++x) {
+            uchar value = src[x] >= level ? 255 : 0;
+            dst[x] = value;
+            if (value && y < tops[x]) tops[x] = static_cast<ushort>(y);
+        }
+    }
+}
+
+void fusedMask(const Mat& gray, int brightness, int threshold, int baselineCutoff, Mat& binary,
+               vector<ushort>& tops, const Rect& region, bool useSimd) {
+    CV_Assert(gray.type() == CV_8UC1);
+    binary.create(gray.size(), CV_8UC1);
+    if (static_cast<int>(tops.size()) != gray.cols) tops.assign(gray.cols, AzimuthEnvelope::kEmpty);
+
+    // Band between the top mask and the baseline inside the region; the rest of the region is background
+    const Rect roi = region & Rect(0, 0, gray.cols, gray.rows);
+    const int startY = max(static_cast<int>(0.1 * gray.rows), roi.y);
+    const int endY = max(startY, min(baselineCutoff == -1 ? gray.rows : baselineCutoff, roi.y + roi.height));
+    Mat columns = binary.colRange(roi.x, roi.x + roi.width);
+    if (roi.y < startY) columns.rowRange(roi.y, min(startY, roi.y + roi.height)).setTo(0);
+    if (endY < roi.y + roi.height) columns.rowRange(endY, roi.y + roi.height).setTo(0);
+
+    // min(255, gray + brightness) > threshold  <=>  gray >= cutoff + 1 (nothing for a cutoff of 255)
+    const int cutoff = pickCutoff(brightness, threshold);
+    if (cutoff >= 255) {
+        columns.rowRange(startY, endY).setTo(0);
+        return;
+    }
+    const uchar level = static_cast<uchar>(max(0, cutoff + 1));
+
+    // Row stripes: each lowers its own copy of the tops, merged top-down afterwards (kept per thread)
+    const int bandRows = endY - startY;
+    const int stripes = max(1, min(getNumThreads(), bandRows / kMinStripeRows));
+    const int cols = roi.width;
+    thread_local vector<ushort> stripeTops;
+    stripeTops.assign(static_cast<size_t>(stripes) * cols, AzimuthEnvelope::kEmpty);
+    ushort* scratch = stripeTops.data();   // The stripe threads see their own thread_local, not this one
+
+    parallel_for_(Range(0, stripes), [&](const Range& range) {
+        for (int s = range.start; s < range.end; ++s) {
+            int y0 = startY + bandRows * s / stripes;
+            int y1 = startY + bandRows * (s + 1) / stripes;
+            maskRows(gray, y0, y1, roi.x, roi.x + cols, level, binary, scratch + static_cast<size_t>(s) * cols, useSimd);
+        }
+    });
+
+    ushort* regionTops = tops.data() + roi.x;
+    for (int s = 0; s < stripes; ++s) {
+        const ushort* part = scratch + static_cast<size_t>(s) * cols;
+        for (int x = 0; x < cols; ++x) regionTops[x] = min(regionTops[x], part[x]);
+    }
+}
+
+} // namespace
+
+int detectBaselineRow(const Mat& frame, Mat& gray, bool detect) {
+    // Convert current frame to grayscale (a gray stream frame is read as it is)
+    const Mat* raw = &frame;
+    if (frame.channels() != 1) {
+        cvtColor(frame, gray, COLOR_BGR2GRAY);
+        raw = &gray;
+    }
+
+    // Baseline candidate from the raw gray: the detector blurs and differentiates only its scan band
+    int detectedY = detect ? BaselineDetector::detectRow(*raw) : -1;
+
+    // Gaussian blur for the pick mask
+    GaussianBlur(*raw, gray, Size(5, 5), 2);
+    return detectedY;
+}
+
+void expandLumaRange(Mat& luma) {
+    static const Mat table = []() {
+        Mat lut(1, 256, CV_8U);
+        for (int y = 0; y < 256; ++y) lut.at<uchar>(y) = saturate_cast<uchar>((y - 16) * 255.0 / 219.0);
+        return lut;
+    }();
+    LUT(luma, table, luma);
+}
+
+bool isStudioRange(const Mat& luma, const Mat& gray) {
+    Mat expanded = luma.clone();
+    expandLumaRange(expanded);
+    return norm(expanded, gray, NORM_L1) <= norm(luma, gray, NORM_L1);
+}
+
+int detectBaselineRow(const Mat& frame, Mat& gray, bool detect, const Rect& roi) {
+    CV_Assert(gray.size() == frame.size() && gray.type() == CV_8UC1);
+
+    // The 5x5 blur reads 2 and the baseline kernel 3 pixels around the region: convert those as well
+    const Rect support = Rect(roi.x - 3, roi.y - 3, roi.width + 6, roi.height + 6) & Rect(0, 0, frame.cols, frame.rows);
+    const Mat* raw = &frame;
+    thread_local Mat converted;   // Full-size per thread, so the region's neighbours are real pixels
+    if (frame.channels() != 1) {
+        if (converted.size() != frame.size()) converted.create(frame.size(), CV_8UC1);
+        Mat target = converted(support);
+        cvtColor(frame(support), target, COLOR_BGR2GRAY);
+        raw = &converted;
+    }
+
+    int detectedY = detect ? BaselineDetector::detectRow(*raw, roi) : -1;
+
+    // A blur of the region view reads its border pixels from the whole frame: identical to the full blur
+    Mat blurred = gray(roi);
+    GaussianBlur((*raw)(roi), blurred, Size(5, 5), 2);
+    return detectedY;
+}
+
+void clearOutsideRegion(Size frameSize, const Rect& roi, Rect& buffersRoi, Mat& gray, Mat& binary) {
+    if (gray.size() == frameSize && binary.size() == frameSize && roi == buffersRoi) return;
+    gray.create(frameSize, CV_8UC1);
+    binary.create(frameSize, CV_8UC1);
+    gray.setTo(0);
+    binary.setTo(0);
+    buffersRoi = roi;
+}
+
+float baselineFromRow(int detectedY) {
+    return detectedY + 2.25f;
+}
+
+int baselineCutoffRow(float baselineY) {
+    return baselineY == -1 ? -1 : static_cast<int>(baselineY);
+}
+
+int pickCutoff(int brightness, int threshold) {
+    return threshold >= 255 ? 255 : min(threshold - brightness, 255);
+}
+
+void thresholdPickMask(const Mat& gray, int brightness, int threshold, int baselineCutoff, Mat& binary) {
+    // Brightness offset and binary threshold in one pass (binary is reused across frames)
+    cv::threshold(gray, binary, pickCutoff(brightness, threshold), 255, THRESH_BINARY);
+
+    // Mask out top 10% of the image
+    int ignoreTop = static_cast<int>(0.1 * binary.rows);
+    binary.rowRange(0, ignoreTop).setTo(0);
+
+    // Mask out everything below baseline (if baseline is available)
+    if (baselineCutoff != -1) {
+        binary.rowRange(baselineCutoff, binary.rows).setTo(0);
+    }
+}
+
+void fusedPickMask(const Mat& gray, int brightness, int threshold, int baselineCutoff, Mat& binary, vector<ushort>& tops) {
+    fusedMask(gray, brightness, threshold, baselineCutoff, binary, tops, Rect(0, 0, gray.cols, gray.rows), true);
+}
+
+void fusedPickMask(const Mat& gray, int brightness, int threshold, int baselineCutoff, Mat& binary, vector<ushort>& tops,
+                   const Rect& roi) {
+    fusedMask(gray, brightness, threshold, baselineCutoff, binary, tops, roi, true);
+}
+
+void fusedPickMaskReference(const Mat& gray, int brightness, int threshold, int baselineCutoff, Mat& binary,
+                            vector<ushort>& tops) {
+    fusedMask(gray, brightness, threshold, baselineCutoff, binary, tops, Rect(0, 0, gray.cols, gray.rows), false);
+}
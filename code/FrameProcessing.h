@@ -0,0 +1,61 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- PER-FRAME PROCESSING KERNELS ------- //
+// Stateless building blocks of the per-frame loop. They only read their arguments, so they can run
+// on any thread; the order-dependent state (fixed baseline, accumulated mask) is merged by the caller.
+
+// Converts a BGR (or gray) frame to blurred grayscale (written to gray) and returns the row of the strongest
+// horizontal edge between 50% and 90% of the frame height, or -1 if there is none (baseline candidate).
+// With detect = false only the gray frame is produced and -1 is returned.
+int detectBaselineRow(const cv::Mat& frame, cv::Mat& gray, bool detect = true);
+
+// detectBaselineRow restricted to a region of the frame (the drum ROI): only the region is converted,
+// scanned for the baseline (band rows and columns inside it) and blurred into gray, which must already
+// have the frame size. Pixels of gray outside the region are left untouched.
+int detectBaselineRow(const cv::Mat& frame, cv::Mat& gray, bool detect, const cv::Rect& roi);
+
+// Sizes gray and binary to the frame and zeroes them whenever the processed region differs from the one
+// they were last cleared for (buffersRoi), so the region-restricted kernels leave background outside it
+void clearOutsideRegion(cv::Size frameSize, const cv::Rect& roi, cv::Rect& buffersRoi, cv::Mat& gray, cv::Mat& binary);
+
+// Expands the studio-range (16-235) Y plane of a decoder in place to the full 0-255 range that
+// cvtColor(BGR2GRAY) gives on the decoder's BGR output, so the pick cutoffs mean the same on both.
+// Only for studio-range sources: a full-range Y plane (yuvj420p, MJPEG) is used as it is
+void expandLumaRange(cv::Mat& luma);
+
+// True if the Y plane of a frame is studio range: expanded, it is closer to the gray of the same frame
+// converted to BGR (cvtColor(BGR2GRAY)) than as it is
+bool isStudioRange(const cv::Mat& luma, const cv::Mat& gray);
+
+// Baseline value stored for a detected baseline row (the detected edge row plus a fixed sub-row offset)
+float baselineFromRow(int detectedY);
+
+// First masked row below the baseline, or -1 while no baseline is available
+int baselineCutoffRow(float baselineY);
+
+// Gray cutoff equivalent to brightness + threshold: with the saturating add, min(255, gray + brightness)
+// > threshold holds exactly when gray > threshold - brightness, and never for threshold >= 255
+int pickCutoff(int brightness, int threshold);
+
+// Brightness offset + binary threshold of the blurred gray frame, as one threshold at pickCutoff. The top
+// 10% and every row from baselineCutoff downwards are masked out (baselineCutoff = -1 keeps everything
+// below the top mask).
+void thresholdPickMask(const cv::Mat& gray, int brightness, int threshold, int baselineCutoff, cv::Mat& binary);
+
+// Pick mask and azimuth accumulation in one pass: only the band rows between the top mask and
+// baselineCutoff are read, in row stripes on parallel threads, and every vectorized comparison both
+// writes the binary (identical to thresholdPickMask, rows outside the band are zeroed) and lowers tops[x]
+// to the first foreground row of column x. tops is reset to the frame width (AzimuthEnvelope::kEmpty) if
+// its size differs, so a per-frame vector or the rows of an accumulated envelope can be passed.
+void fusedPickMask(const cv::Mat& gray, int brightness, int threshold, int baselineCutoff, cv::Mat& binary,
+                   std::vector<unsigned short>& tops);
+// The same restricted to a region: the band is clipped to its rows and columns, binary and tops outside
+// it are left untouched
+void fusedPickMask(const cv::Mat& gray, int brightness, int threshold, int baselineCutoff, cv::Mat& binary,
+                   std::vector<unsigned short>& tops, const cv::Rect& roi);
+
+// Scalar version of fusedPickMask (verification of the vectorized kernel)
+void fusedPickMaskReference(const cv::Mat& gray, int brightness, int threshold, int baselineCutoff, cv::Mat& binary,
+                            std::vector<unsigned short>& tops);
@@ -0,0 +1,69 @@
+#include "FrameSource.h"
+#include "FrameProcessing.h"
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+
+bool FrameSource::skip() {
+    double timestampMs;
+    return read(scratch, timestampMs);
+}
+
+VideoFileSource::VideoFileSource(VideoCapture& capture, bool lumaMode) : cap(capture), luma(false) {
+    if (lumaMode && cap.set(CAP_PROP_CONVERT_RGB, 0)) {
+        luma = true;
+        lumaRows = static_cast<int>(cap.get(CAP_PROP_FRAME_HEIGHT));
+    }
+}
+
+VideoFileSource::~VideoFileSource() {
+    if (luma) cap.set(CAP_PROP_CONVERT_RGB, 1);
+}
+
+bool VideoFileSource::read(Mat& frame, double& timestampMs) {
+    // A reused frame is the Y plane view of an earlier read: widen it back to the whole decoder
+    // buffer, so the decoder refills it in place instead of allocating a new one
+    if (luma && frame.isSubmatrix()) {
+        Size whole;
+        Point offset;
+        frame.locateROI(whole, offset);
+        frame.adjustROI(offset.y, whole.height - offset.y - frame.rows, offset.x, whole.width - offset.x - frame.cols);
+    }
+
+    if (!cap.read(frame)) return false;
+    timestampMs = cap.get(CAP_PROP_POS_MSEC); // Get timestamp in milliseconds
+    if (!luma) return true;
+
+    if (frame.type() == CV_8UC1 && frame.rows == lumaRows) return true;                   // Gray already
+    if (frame.type() == CV_8UC1 && frame.rows == lumaRows * 3 / 2) {                       // I420 / NV12 / YV12
+        frame = frame.rowRange(0, lumaRows);                                                 // Y plane, no copy
+        if (!rangeChecked) {
+            // Once per source: the decoder's BGR conversion of the same frame tells the range of the plane
+            rangeChecked = true;
+            Mat bgr, gray;
+            cap.set(CAP_PROP_CONVERT_RGB, 1);
+            bool converted = cap.retrieve(bgr) && bgr.size() == frame.size() && bgr.type() == CV_8UC3;
+            cap.set(CAP_PROP_CONVERT_RGB, 0);
+            if (converted) {
+                cvtColor(bgr, gray, COLOR_BGR2GRAY);
+                studioRange = isStudioRange(frame, gray);
+            }
+        }
+        if (studioRange) expandLumaRange(frame);
+        return true;
+    }
+
+    // Packed or unknown raw layout: back to BGR, starting with this frame
+    luma = false;
+    cap.set(CAP_PROP_CONVERT_RGB, 1);
+    return cap.retrieve(frame);
+}
+
+bool VideoFileSource::skip() {
+    return cap.grab();   // Decoded but not converted to BGR
+}
+
+bool VideoFileSource::rewind() {
+    // If we reached the end of the video, loop back to the start
+    cap.set(CAP_PROP_POS_FRAMES, 0);
+    return true;
+}
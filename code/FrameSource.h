@@ -0,0 +1,55 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+
+// ------- FRAME SOURCE ------- //
+// Where the pipeline's decoder thread takes its frames from: a video file (VideoFileSource) or a raw
+// frame stream of a capture process (StreamSource). Only the decoder thread reads; returnFrame() is
+// called by the consumer and interrupt() by the thread stopping the pipeline.
+
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // Next frame (BGR, or gray from a gray stream) and its timestamp; false at the end of the input.
+    // frame holds the buffer of an earlier read and is reused where possible; a source may also replace
+    // it by a header over its own memory, which stays valid until the frame is returned.
+    virtual bool read(cv::Mat& frame, double& timestampMs) = 0;
+    // Reads past the next frame without keeping it (DropNewest backpressure); false at the end
+    virtual bool skip();
+    // Back to the first frame (looped playback); false if the input cannot seek
+    virtual bool rewind() { return false; }
+    // The oldest frame read and not yet returned is no longer used (frames are returned in read order)
+    virtual void returnFrame() {}
+    // Makes a read that waits for the producer give up (the pipeline is stopping)
+    virtual void interrupt() {}
+
+private:
+    cv::Mat scratch;                  // Target of the default skip()
+};
+
+// Frames of an opened cv::VideoCapture.
+// Luma mode: the analysis only uses gray, so the decoder's color conversion is switched off
+// (CAP_PROP_CONVERT_RGB) and the frames are the Y plane of its output, a gray Mat without a copy (a
+// header over the first rows of a planar YUV buffer, or the gray frame a backend delivers directly).
+// The range of a planar Y plane is decided once, on the first frame, against the decoder's own BGR
+// conversion of it; a studio-range (16-235) plane is expanded to full range in place, a full-range one
+// (yuvj420p, MJPEG) is used as it is. Display and export convert the few frames they show. If the backend
+// ignores the property or delivers a packed layout, the source falls back to BGR frames.
+class VideoFileSource : public FrameSource {
+public:
+    explicit VideoFileSource(cv::VideoCapture& capture, bool luma = false);
+    ~VideoFileSource() override;   // Restores the color conversion of the caller's capture
+
+    bool read(cv::Mat& frame, double& timestampMs) override;
+    bool skip() override;
+    bool rewind() override;
+
+    bool lumaFrames() const { return luma; }
+
+private:
+    cv::VideoCapture& cap;
+    bool luma;
+    int lumaRows = 0;                 // Frame height: the rows of the Y plane
+    bool rangeChecked = false;        // Range of the Y plane decided (first planar frame)
+    bool studioRange = true;          // Y plane in 16-235: expanded to 0-255
+};
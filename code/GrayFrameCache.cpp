@@ -0,0 +1,137 @@
+#include "GrayFrameCache.h"
+#include "FrameProcessing.h"
+#include <algorithm>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// factor x factor max-pooling (partial blocks at the right and bottom edge are pooled as well)
+void maxPool(const Mat& src, int factor, Mat& dst) {
+    dst.create((src.rows + factor - 1) / factor, (src.cols + factor - 1) / factor, CV_8UC1);
+    for (int y = 0; y < dst.rows; ++y) {
+        uchar* out = dst.ptr<uchar>(y);
+        const int rowEnd = min(src.rows, (y + 1) * factor);
+        for (int x = 0; x < dst.cols; ++x) {
+            const int colEnd = min(src.cols, (x + 1) * factor);
+            uchar value = 0;
+            for (int sy = y * factor; sy < rowEnd; ++sy) {
+                const uchar* row = src.ptr<uchar>(sy);
+                for (int sx = x * factor; sx < colEnd; ++sx) value = max(value, row[sx]);
+            }
+            out[x] = value;
+        }
+    }
+}
+
+} // namespace
+
+GrayFrameCache::GrayFrameCache(const GrayCacheConfig& options) : config(options) {
+    config.downsample = max(1, config.downsample);
+}
+
+void GrayFrameCache::push(long long frameIndex, const Mat& gray, int endRow, int period) {
+    store(frameIndex, gray, true, config.downsample, gray.size(), endRow, period);
+}
+
+void GrayFrameCache::pushLevel(long long frameIndex, const Mat& level, int levelScale, Size size, int endRow, int period) {
+    store(frameIndex, level, false, max(1, levelScale), size, endRow, period);
+}
+
+void GrayFrameCache::store(long long frameIndex, const Mat& gray, bool pooled, int factor, Size size, int endRow, int period) {
+    if (!enabled() || gray.empty()) return;
+    CV_Assert(gray.type() == CV_8UC1);
+    if (size != frameSize || factor != scale) {
+        clear();
+        frameSize = size;
+        scale = factor;
+    }
+
+    // A native frame is pooled from the top mask on; a level starts at the level row containing it
+    const int top = static_cast<int>(0.1 * size.height);
+    const int bottom = endRow < 0 ? size.height : min(endRow, size.height);
+    if (top >= bottom) return;
+    bandTop = pooled ? top : top / factor * factor;
+
+    const int rows = (bottom - bandTop + factor - 1) / factor;
+    const int cols = (size.width + factor - 1) / factor;
+    const size_t incoming = static_cast<size_t>(rows) * cols;
+    const size_t budget = static_cast<size_t>(config.budgetMB) << 20;
+    if (incoming > budget) return;
+
+    // Drop frames outside the last rotation or the budget
+    while (count > 0 &&
+           (usedBytes + incoming > budget || (period > 0 && ring[head].index <= frameIndex - period))) {
+        usedBytes -= ring[head].band.total();
+        head = (head + 1) % ring.size();
+        --count;
+    }
+
+    // The slot after the newest frame; a full ring gets a new slot there (warm-up only)
+    size_t slot = ring.empty() ? 0 : (head + count) % ring.size();
+    if (count == ring.size()) {
+        ring.insert(ring.begin() + slot, Entry());
+        if (count > 0) head = (head + 1) % ring.size();
+    }
+
+    // Buffers keep their size: the baseline only moves up, so later bands fit into earlier buffers
+    Entry& entry = ring[slot];
+    if (entry.buffer.rows < rows || entry.buffer.cols != cols) entry.buffer.create(rows, cols, CV_8UC1);
+    entry.band = entry.buffer.rowRange(0, rows);
+    entry.index = frameIndex;
+    if (!pooled) {
+        const int first = bandTop / factor;
+        entry.band = entry.band.rowRange(0, min(rows, gray.rows - first));
+        gray.rowRange(first, first + entry.band.rows).copyTo(entry.band);
+    }
+    else if (factor > 1) maxPool(gray.rowRange(top, bottom), factor, entry.band);
+    else gray.rowRange(top, bottom).copyTo(entry.band);
+    usedBytes += entry.band.total();
+    ++count;
+}
+
+void GrayFrameCache::clear() {
+    ring.clear();
+    head = 0;
+    count = 0;
+    usedBytes = 0;
+}
+
+int GrayFrameCache::rebuild(AzimuthEnvelope& envelope, int brightness, int threshold, int cutoffRow) const {
+    if (count == 0) return 0;
+
+    // Per-pixel maximum of the cached bands; every stripe reduces its rows over all frames
+    int bandRows = 0;
+    for (size_t i = 0; i < count; ++i) bandRows = max(bandRows, ring[(head + i) % ring.size()].band.rows);
+    Mat maximum(bandRows, ring[head].band.cols, CV_8UC1, Scalar(0));
+    parallel_for_(Range(0, bandRows), [&](const Range& range) {
+        for (size_t i = 0; i < count; ++i) {
+            const Entry& entry = ring[(head + i) % ring.size()];
+            const int end = min(range.end, entry.band.rows);
+            if (end <= range.start) continue;
+            Mat rows = maximum.rowRange(range.start, end);
+            cv::max(rows, entry.band.rowRange(range.start, end), rows);
+        }
+    });
+
+    // Back to a native frame: the band below the top mask, nothing outside it
+    const int factor = scale;
+    const int top = bandTop;
+    if (factor > 1) {
+        Mat upsampled;
+        resize(maximum, upsampled, Size(maximum.cols * factor, maximum.rows * factor), 0, 0, INTER_NEAREST);
+        maximum = upsampled(Rect(0, 0, frameSize.width, min(upsampled.rows, frameSize.height - top)));
+    }
+    Mat gray(frameSize, CV_8UC1, Scalar(0));
+    Mat band = gray.rowRange(top, top + maximum.rows);
+    maximum.copyTo(band);
+
+    // Rows below the cached band hold no frame data: end the mask there
+    const int endRow = cutoffRow < 0 ? top + maximum.rows : min(cutoffRow, top + maximum.rows);
+    Mat binary;
+    vector<ushort> tops;
+    fusedPickMask(gray, brightness, threshold, endRow, binary, tops);
+    envelope.assign(tops);
+    return static_cast<int>(count);
+}
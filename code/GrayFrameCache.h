@@ -0,0 +1,65 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+#include "AzimuthEnvelope.h"
+
+// ------- GRAY FRAME CACHE ------- //
+// The blurred gray frames of the last drum rotation, so a trackbar change (or a window resize) can
+// rebuild the azimuth envelope at once instead of over a rotation of live playback. Only the pick band
+// is kept: rows from the top mask down to the baseline cutoff the frame was consumed with, optionally
+// 2x2 max-pooled. Frames older than one rotation period (when known) or beyond the memory budget are
+// dropped, oldest first. The frames live in a ring of buffers that only grows while the cache fills: a
+// dropped frame's buffer takes the next one, so a full cache does not allocate.
+//
+// The mask is a monotonic function of the gray value, so the envelope of all cached frames equals the
+// envelope of their per-pixel maximum: the rebuild max-reduces the cache in parallel row stripes and
+// thresholds that one image with the normal pick mask kernel. With max-pooling the rebuilt rows are
+// conservative (at most one row too high) until live frames refine them. In pyramid mode the cache keeps
+// the blurred pyramid level of each frame instead (no full-resolution gray frame exists); its rebuilt rows
+// are within one level pixel of the live ones.
+
+struct GrayCacheConfig {
+    int budgetMB = 256;               // --gray-cache-mb N : memory for cached frames (0 = off)
+    int downsample = 1;               // --gray-cache-scale 2 : 2x2 max-pooled frames (1 = native)
+};
+
+class GrayFrameCache {
+public:
+    explicit GrayFrameCache(const GrayCacheConfig& config = GrayCacheConfig());
+
+    bool enabled() const { return config.budgetMB > 0; }
+    size_t frames() const { return count; }
+    // Frame buffers allocated so far (in use or free)
+    size_t slots() const { return ring.size(); }
+    size_t bytes() const { return usedBytes; }
+
+    // Keeps the pick band of a blurred gray frame (rows above endRow, -1 = all). period: rotation period
+    // in frames, 0 while unknown (then only the budget limits the cache).
+    void push(long long frameIndex, const cv::Mat& gray, int endRow, int period);
+    // The same for a blurred pyramid level (frameSize downsampled by scale), kept as it is
+    void pushLevel(long long frameIndex, const cv::Mat& level, int scale, cv::Size frameSize, int endRow, int period);
+    void clear();
+
+    // Replaces envelope by the envelope of every cached frame thresholded with brightness / threshold
+    // and masked from cutoffRow down (-1 = no baseline). Returns the number of frames used; envelope is
+    // left untouched if the cache is empty.
+    int rebuild(AzimuthEnvelope& envelope, int brightness, int threshold, int cutoffRow) const;
+
+private:
+    void store(long long frameIndex, const cv::Mat& gray, bool pooled, int factor, cv::Size size, int endRow, int period);
+
+    struct Entry {
+        long long index = 0;
+        cv::Mat buffer;               // Allocated once per slot
+        cv::Mat band;                 // Rows [bandTop, endRow) of the frame, downsampled (top of buffer)
+    };
+
+    GrayCacheConfig config;
+    std::vector<Entry> ring;          // Frames [head, head + count) (wrapping), oldest first
+    size_t head = 0;
+    size_t count = 0;
+    size_t usedBytes = 0;
+    cv::Size frameSize;               // Native size of the cached frames
+    int scale = 1;                    // Downsampling of the cached frames
+    int bandTop = 0;                  // Native row of the first cached row (the top mask, rounded down to the scale)
+};
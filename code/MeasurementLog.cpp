@@ -0,0 +1,357 @@
+#include "MeasurementLog.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const char kFileMagic[8] = { 'C', 'W', 'M', 'L', 'O', 'G', 0, 0 };
+const uint32_t kVersion = 1;
+const uint32_t kBlockMagic = 0x314B4C42;   // "BLK1"
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t frames;
+    uint32_t picks;
+    uint32_t tips;
+    uint64_t bytes;     // Whole block including this header
+};
+
+static_assert(sizeof(FileHeader) == 16, "file header layout");
+static_assert(sizeof(BlockHeader) == 24, "block header layout");
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+// Byte offsets of the columns of a block
+struct BlockLayout {
+    size_t timestampMs, baselineY, cuttingSpacing, pickCount, tipCount;
+    size_t pickX, pickHeight, tipX, tipHeight;
+    size_t bytes;
+
+    BlockLayout(size_t frames, size_t picks, size_t tips) {
+        size_t offset = sizeof(BlockHeader);
+        auto column = [&offset](size_t bytes) { size_t start = offset; offset += padded(bytes); return start; };
+        timestampMs = column(frames * sizeof(double));
+        baselineY = column(frames * sizeof(float));
+        cuttingSpacing = column(frames * sizeof(int32_t));
+        pickCount = column(frames * sizeof(uint32_t));
+        tipCount = column(frames * sizeof(uint32_t));
+        pickX = column(picks * sizeof(int32_t));
+        pickHeight = column(picks * sizeof(int32_t));
+        tipX = column(tips * sizeof(int32_t));
+        tipHeight = column(tips * sizeof(int32_t));
+        bytes = offset;
+    }
+};
+
+// End of the last complete block of the file in the stream (the file header already checked)
+size_t completeBlocksEnd(istream& in, size_t fileBytes) {
+    size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= fileBytes) {
+        BlockHeader header;
+        in.seekg(static_cast<streamoff>(offset));
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) break;
+        BlockLayout layout(header.frames, header.picks, header.tips);
+        if (header.magic != kBlockMagic || header.bytes != layout.bytes || layout.bytes > fileBytes - offset) break;
+        offset += layout.bytes;
+    }
+    return offset;
+}
+
+// Cuts the file to bytes (drops an incomplete block at its end)
+bool truncateFile(const string& path, size_t bytes) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(bytes);
+    bool done = SetFilePointerEx(handle, end, nullptr, FILE_BEGIN) && SetEndOfFile(handle);
+    CloseHandle(handle);
+    return done;
+#else
+    return ::truncate(path.c_str(), static_cast<off_t>(bytes)) == 0;
+#endif
+}
+
+template <typename T>
+void store(vector<char>& buffer, size_t offset, size_t index, T value) {
+    memcpy(buffer.data() + offset + index * sizeof(T), &value, sizeof(T));
+}
+
+} // namespace
+
+// ------- WRITER ------- //
+
+MeasurementLog::MeasurementLog(const string& path, int frames, int intervalMs)
+    : filePath(path), batchFrames(static_cast<size_t>(max(1, frames))), flushIntervalMs(max(1, intervalMs)) {
+    // An existing file must be a measurement log; it is continued, never overwritten
+    size_t existing = 0;
+    {
+        ifstream in(path, ios::binary | ios::ate);
+        if (in) {
+            existing = static_cast<size_t>(in.tellg());
+            if (existing > 0) {
+                FileHeader header;
+                in.seekg(0);
+                if (existing < sizeof(header) || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                    memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header.version != kVersion) {
+                    return;
+                }
+
+                // A block cut short by a crash: new blocks must follow the last complete one, or the reader
+                // would take the torn header's byte count into the new blocks
+                size_t complete = completeBlocksEnd(in, existing);
+                if (complete < existing) {
+                    in.close();
+                    if (!truncateFile(path, complete)) return;
+                    existing = complete;
+                }
+            }
+        }
+    }
+
+    file.open(path, ios::binary | ios::app);
+    if (!file) return;
+
+    if (existing == 0) {
+        FileHeader header;
+        memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        header.version = kVersion;
+        header.reserved = 0;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    file.flush();
+
+    writer = thread(&MeasurementLog::writerLoop, this);
+}
+
+MeasurementLog::~MeasurementLog() {
+    if (!writer.joinable()) return;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+}
+
+void MeasurementLog::append(const AnalysisResult& result) {
+    if (!isOpen()) return;
+
+    Frame frame;
+    frame.timestampMs = result.timestampMs;
+    frame.baselineY = result.baselineY;
+    frame.cuttingSpacing = result.cuttingSpacing;
+    frame.picks = result.azimuthPicks;
+    frame.tips = result.matchedTips;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        pending.push_back(move(frame));
+        ++appendedFrames;
+    }
+    wake.notify_one();
+}
+
+void MeasurementLog::flush() {
+    if (!isOpen()) return;
+
+    unique_lock<std::mutex> lock(mutex);
+    long long target = appendedFrames;
+    flushRequested = true;
+    wake.notify_one();
+    written.wait(lock, [this, target]() { return writtenFrames >= target; });
+}
+
+void MeasurementLog::writerLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+
+        // Let the batch fill up, but never hold frames longer than the flush interval
+        wake.wait_for(lock, chrono::milliseconds(flushIntervalMs), [this]() {
+            return stopping || flushRequested || pending.size() >= batchFrames;
+        });
+        if (pending.empty()) {
+            if (stopping) break;
+            continue;
+        }
+
+        vector<Frame> batch;
+        batch.swap(pending);
+        flushRequested = false;
+
+        lock.unlock();
+        writeBlock(batch);
+        lock.lock();
+
+        writtenFrames += static_cast<long long>(batch.size());
+        written.notify_all();
+    }
+}
+
+void MeasurementLog::writeBlock(const vector<Frame>& frames) {
+    size_t picks = 0, tips = 0;
+    for (const Frame& frame : frames) {
+        picks += frame.picks.size();
+        tips += frame.tips.size();
+    }
+
+    BlockLayout layout(frames.size(), picks, tips);
+    vector<char> buffer(layout.bytes, 0);
+
+    BlockHeader header;
+    header.magic = kBlockMagic;
+    header.frames = static_cast<uint32_t>(frames.size());
+    header.picks = static_cast<uint32_t>(picks);
+    header.tips = static_cast<uint32_t>(tips);
+    header.bytes = layout.bytes;
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    size_t pick = 0, tip = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Frame& frame = frames[i];
+        store<double>(buffer, layout.timestampMs, i, frame.timestampMs);
+        store<float>(buffer, layout.baselineY, i, frame.baselineY);
+        store<int32_t>(buffer, layout.cuttingSpacing, i, frame.cuttingSpacing);
+        store<uint32_t>(buffer, layout.pickCount, i, static_cast<uint32_t>(frame.picks.size()));
+        store<uint32_t>(buffer, layout.tipCount, i, static_cast<uint32_t>(frame.tips.size()));
+        for (const PickMeasurement& p : frame.picks) {
+            store<int32_t>(buffer, layout.pickX, pick, p.position.x);
+            store<int32_t>(buffer, layout.pickHeight, pick++, p.height);
+        }
+        for (const PickMeasurement& t : frame.tips) {
+            store<int32_t>(buffer, layout.tipX, tip, t.position.x);
+            store<int32_t>(buffer, layout.tipHeight, tip++, t.height);
+        }
+    }
+
+    // One write per block: a crash leaves at most this block incomplete
+    file.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    file.flush();
+}
+
+// ------- READER ------- //
+
+MeasurementLogReader::~MeasurementLogReader() {
+    close();
+}
+
+bool MeasurementLogReader::open(const string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fileHandle);
+    if (!mappingHandle) return false;
+    const void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mappingHandle);
+        return false;
+    }
+    mapping = mappingHandle;
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(info.st_size);
+#endif
+
+    FileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 || header.version != kVersion) {
+        close();
+        return false;
+    }
+
+    // Walk the blocks up to the first incomplete one (an interrupted write the writer has not cut off yet):
+    // its header cannot be trusted, so nothing behind it is read
+    size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= size) {
+        BlockHeader blockHeader;
+        memcpy(&blockHeader, data + offset, sizeof(blockHeader));
+        BlockLayout layout(blockHeader.frames, blockHeader.picks, blockHeader.tips);
+        bool valid = blockHeader.magic == kBlockMagic && blockHeader.bytes == layout.bytes && layout.bytes <= size - offset;
+        if (!valid) break;
+
+        const char* base = data + offset;
+        Block block;
+        block.frames = blockHeader.frames;
+        block.picks = blockHeader.picks;
+        block.tips = blockHeader.tips;
+        block.timestampMs = reinterpret_cast<const double*>(base + layout.timestampMs);
+        block.baselineY = reinterpret_cast<const float*>(base + layout.baselineY);
+        block.cuttingSpacing = reinterpret_cast<const int32_t*>(base + layout.cuttingSpacing);
+        block.pickCount = reinterpret_cast<const uint32_t*>(base + layout.pickCount);
+        block.tipCount = reinterpret_cast<const uint32_t*>(base + layout.tipCount);
+        block.pickX = reinterpret_cast<const int32_t*>(base + layout.pickX);
+        block.pickHeight = reinterpret_cast<const int32_t*>(base + layout.pickHeight);
+        block.tipX = reinterpret_cast<const int32_t*>(base + layout.tipX);
+        block.tipHeight = reinterpret_cast<const int32_t*>(base + layout.tipHeight);
+        blockList.push_back(block);
+        offset += layout.bytes;
+    }
+    trailing += size - offset;
+    return true;
+}
+
+void MeasurementLogReader::close() {
+    if (data) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mapping));
+#else
+        munmap(const_cast<char*>(data), size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+    mapping = nullptr;
+    blockList.clear();
+    trailing = 0;
+}
+
+size_t MeasurementLogReader::frameCount() const {
+    size_t frames = 0;
+    for (const Block& block : blockList) frames += block.frames;
+    return frames;
+}
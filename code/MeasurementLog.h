@@ -0,0 +1,114 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameAnalyzer.h"
+
+// ------- MEASUREMENT LOG ------- //
+// Append-only binary store of the measurements of every analyzed frame (<video>_measurements.mlog).
+// The file is a 16-byte header followed by blocks; a block holds a batch of frames column by column,
+// so a reader maps the file and walks e.g. all tip heights without parsing anything:
+//
+//   file header   "CWMLOG\0\0", uint32 version, uint32 reserved
+//   block header  uint32 magic, uint32 frames, uint32 picks, uint32 tips, uint64 block bytes
+//   frame columns double timestampMs, float baselineY, int32 cuttingSpacing, uint32 pickCount, uint32 tipCount
+//   pick columns  int32 x, int32 height   (azimuth picks of all frames of the block, in frame order)
+//   tip columns   int32 x, int32 height   (matched tips of all frames of the block, in frame order)
+//
+// Every column starts on an 8-byte boundary. Values are little-endian (native on all supported targets).
+// Coordinates and heights are zoomed px, as in the text report. A block cut short by a crash is cut off
+// when the log is next opened for appending, so new blocks follow the last complete one; the reader stops
+// at an incomplete block, earlier blocks stay valid.
+
+class MeasurementLog {
+public:
+    // Opens (or creates) the log for appending. Blocks are written by a background thread once
+    // batchFrames frames are pending, or flushIntervalMs after the first pending frame.
+    explicit MeasurementLog(const std::string& path, int batchFrames = 256, int flushIntervalMs = 1000);
+    // Writes what is still pending
+    ~MeasurementLog();
+
+    MeasurementLog(const MeasurementLog&) = delete;
+    MeasurementLog& operator=(const MeasurementLog&) = delete;
+
+    // False if the file cannot be written or holds something else than a measurement log
+    bool isOpen() const { return file.is_open(); }
+    const std::string& path() const { return filePath; }
+
+    // Queues the measurements of one frame (cheap: copies the few numbers, never touches the file)
+    void append(const AnalysisResult& result);
+    // Blocks until everything appended so far is written
+    void flush();
+
+private:
+    struct Frame {
+        double timestampMs;
+        float baselineY;
+        int cuttingSpacing;
+        std::vector<PickMeasurement> picks;
+        std::vector<PickMeasurement> tips;
+    };
+
+    void writerLoop();
+    void writeBlock(const std::vector<Frame>& frames);
+
+    std::string filePath;
+    std::ofstream file;
+    size_t batchFrames;
+    int flushIntervalMs;
+
+    std::mutex mutex;
+    std::condition_variable wake;       // Writer: frames pending or stopping
+    std::condition_variable written;    // flush(): a batch was written
+    std::vector<Frame> pending;
+    long long appendedFrames = 0;
+    long long writtenFrames = 0;
+    bool flushRequested = false;
+    bool stopping = false;
+    std::thread writer;
+};
+
+// Read side: maps a measurement log and exposes its blocks as column pointers into the mapping
+class MeasurementLogReader {
+public:
+    struct Block {
+        size_t frames = 0, picks = 0, tips = 0;
+        const double* timestampMs = nullptr;
+        const float* baselineY = nullptr;
+        const std::int32_t* cuttingSpacing = nullptr;
+        const std::uint32_t* pickCount = nullptr;   // Picks of each frame (consecutive in pickX / pickHeight)
+        const std::uint32_t* tipCount = nullptr;    // Tips of each frame (consecutive in tipX / tipHeight)
+        const std::int32_t* pickX = nullptr;
+        const std::int32_t* pickHeight = nullptr;
+        const std::int32_t* tipX = nullptr;
+        const std::int32_t* tipHeight = nullptr;
+    };
+
+    MeasurementLogReader() = default;
+    ~MeasurementLogReader();
+
+    MeasurementLogReader(const MeasurementLogReader&) = delete;
+    MeasurementLogReader& operator=(const MeasurementLogReader&) = delete;
+
+    // False if the file cannot be mapped or is not a measurement log
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<Block>& blocks() const { return blockList; }
+    size_t frameCount() const;
+    // Bytes outside complete blocks (interrupted writes), ignored
+    size_t trailingBytes() const { return trailing; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    void* mapping = nullptr;            // Platform handle of the mapping
+    std::vector<Block> blockList;
+    size_t trailing = 0;
+};
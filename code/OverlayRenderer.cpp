@@ -0,0 +1,215 @@
+#include "OverlayRenderer.h"
+#include <cmath>
+#include <fstream>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const float kDashLength = 10.f;   // Output px
+const float kGapLength = 5.f;     // Output px
+
+// Liang-Barsky clipping of segment a-b to rect; false if nothing is left
+bool clipSegment(Point2f& a, Point2f& b, const Rect2f& rect) {
+    float t0 = 0.f, t1 = 1.f;
+    float dx = b.x - a.x, dy = b.y - a.y;
+    const float p[4] = { -dx, dx, -dy, dy };
+    const float q[4] = { a.x - rect.x, rect.x + rect.width - a.x, a.y - rect.y, rect.y + rect.height - a.y };
+
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return false;   // Parallel and outside
+            continue;
+        }
+        float t = q[i] / p[i];
+        if (p[i] < 0) t0 = max(t0, t);
+        else t1 = min(t1, t);
+        if (t0 > t1) return false;
+    }
+
+    Point2f start(a.x + t0 * dx, a.y + t0 * dy);
+    Point2f end(a.x + t1 * dx, a.y + t1 * dy);
+    a = start;
+    b = end;
+    return true;
+}
+
+Point toOutput(Point2f p, double scale) {
+    return Point(cvRound(p.x * scale), cvRound(p.y * scale));
+}
+
+// Dashed segment in output px (dash pattern restarts at every segment like the original dashed lines)
+void drawDashedSegment(Mat& img, Point from, Point to, const Scalar& color, int thickness) {
+    float dx = static_cast<float>(to.x - from.x), dy = static_cast<float>(to.y - from.y);
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length == 0) return;
+    dx /= length;
+    dy /= length;
+
+    for (float d = 0; d < length; d += kDashLength + kGapLength) {
+        float dEnd = min(d + kDashLength, length);
+        Point a(cvRound(from.x + dx * d), cvRound(from.y + dy * d));
+        Point b(cvRound(from.x + dx * dEnd), cvRound(from.y + dy * dEnd));
+        cv::line(img, a, b, color, thickness);
+    }
+}
+
+string svgColor(const Scalar& bgr) {
+    return "rgb(" + to_string(static_cast<int>(bgr[2])) + "," + to_string(static_cast<int>(bgr[1])) + ","
+        + to_string(static_cast<int>(bgr[0])) + ")";
+}
+
+string svgEscape(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '&') escaped += "&amp;";
+        else if (c == '<') escaped += "&lt;";
+        else if (c == '>') escaped += "&gt;";
+        else if (c == '"') escaped += "&quot;";
+        else escaped += c;
+    }
+    return escaped;
+}
+
+// Height of the capital letters of a Hershey font in output px, used as SVG font size
+double svgFontSize(int fontFace, double fontScale) {
+    int baseline = 0;
+    Size size = getTextSize("H", fontFace, fontScale, 1, &baseline);
+    return size.height * 1.35;  // Cap height -> em size
+}
+
+} // namespace
+
+void Overlay::polyline(const vector<Point2f>& points, bool closed, const Scalar& color, int thickness, bool dashed) {
+    if (points.empty()) return;
+    OverlayPrimitive item;
+    item.kind = OverlayKind::Polyline;
+    item.points = points;
+    item.closed = closed;
+    item.dashed = dashed;
+    item.color = color;
+    item.thickness = thickness;
+    items.push_back(item);
+}
+
+void Overlay::line(Point2f from, Point2f to, const Scalar& color, int thickness, bool dashed) {
+    polyline(vector<Point2f>{ from, to }, false, color, thickness, dashed);
+}
+
+void Overlay::circle(Point2f center, float radius, const Scalar& color, int thickness) {
+    OverlayPrimitive item;
+    item.kind = OverlayKind::Circle;
+    item.points.push_back(center);
+    item.radius = radius;
+    item.color = color;
+    item.thickness = thickness;
+    items.push_back(item);
+}
+
+void Overlay::text(const string& text, Point2f anchor, Point2f offset, int fontFace, double fontScale,
+                   const Scalar& color, int thickness) {
+    OverlayPrimitive item;
+    item.kind = OverlayKind::Text;
+    item.points.push_back(anchor);
+    item.text = text;
+    item.offset = offset;
+    item.fontFace = fontFace;
+    item.fontScale = fontScale;
+    item.color = color;
+    item.thickness = thickness;
+    items.push_back(item);
+}
+
+void Overlay::clippedPolyline(const vector<Point2f>& points, const Rect2f& clip, const Scalar& color, int thickness) {
+    vector<Point2f> piece;
+    for (size_t i = 1; i < points.size(); ++i) {
+        Point2f a = points[i - 1], b = points[i];
+        if (!clipSegment(a, b, clip)) {
+            polyline(piece, false, color, thickness);
+            piece.clear();
+            continue;
+        }
+        // Continue the current piece if this segment starts where the last one ended
+        if (!piece.empty() && piece.back() != a) {
+            polyline(piece, false, color, thickness);
+            piece.clear();
+        }
+        if (piece.empty()) piece.push_back(a);
+        piece.push_back(b);
+    }
+    polyline(piece, false, color, thickness);
+}
+
+Mat Overlay::render(const Mat& frame, double scale) const {
+    Mat out;
+    resize(frame, out, Size(), scale, scale, INTER_LINEAR);  // INTER_LINEAR = smooth scaling
+
+    for (const auto& item : items) {
+        switch (item.kind) {
+        case OverlayKind::Polyline: {
+            vector<Point> pts;
+            for (const Point2f& p : item.points) pts.push_back(toOutput(p, scale));
+            if (!item.dashed) {
+                polylines(out, pts, item.closed, item.color, item.thickness);
+            }
+            else {
+                for (size_t i = 1; i < pts.size(); ++i) drawDashedSegment(out, pts[i - 1], pts[i], item.color, item.thickness);
+                if (item.closed && pts.size() > 2) drawDashedSegment(out, pts.back(), pts.front(), item.color, item.thickness);
+            }
+            break;
+        }
+        case OverlayKind::Circle:
+            cv::circle(out, toOutput(item.points[0], scale), cvRound(item.radius), item.color, item.thickness);
+            break;
+        case OverlayKind::Text: {
+            Point origin = toOutput(item.points[0], scale) + Point(cvRound(item.offset.x), cvRound(item.offset.y));
+            putText(out, item.text, origin, item.fontFace, item.fontScale, item.color, item.thickness);
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+bool Overlay::writeSvg(const string& path, const string& imageHref, Size nativeSize, double scale) const {
+    ofstream svg(path);
+    if (!svg) return false;
+
+    int width = cvRound(nativeSize.width * scale), height = cvRound(nativeSize.height * scale);
+    svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\""
+        << width << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << " " << height << "\">\n";
+    svg << "  <image xlink:href=\"" << svgEscape(imageHref) << "\" x=\"0\" y=\"0\" width=\"" << width << "\" height=\""
+        << height << "\" preserveAspectRatio=\"none\"/>\n";
+
+    for (const auto& item : items) {
+        string color = svgColor(item.color);
+        switch (item.kind) {
+        case OverlayKind::Polyline: {
+            svg << "  <" << (item.closed ? "polygon" : "polyline") << " points=\"";
+            for (const Point2f& p : item.points) svg << p.x * scale << "," << p.y * scale << " ";
+            svg << "\" fill=\"none\" stroke=\"" << color << "\" stroke-width=\"" << item.thickness << "\"";
+            if (item.dashed) svg << " stroke-dasharray=\"" << kDashLength << "," << kGapLength << "\"";
+            svg << "/>\n";
+            break;
+        }
+        case OverlayKind::Circle: {
+            const Point2f& c = item.points[0];
+            svg << "  <circle cx=\"" << c.x * scale << "\" cy=\"" << c.y * scale << "\" r=\"" << item.radius << "\"";
+            if (item.thickness < 0) svg << " fill=\"" << color << "\"/>\n";
+            else svg << " fill=\"none\" stroke=\"" << color << "\" stroke-width=\"" << item.thickness << "\"/>\n";
+            break;
+        }
+        case OverlayKind::Text: {
+            const Point2f& a = item.points[0];
+            svg << "  <text x=\"" << a.x * scale + item.offset.x << "\" y=\"" << a.y * scale + item.offset.y
+                << "\" font-family=\"monospace\" font-size=\"" << svgFontSize(item.fontFace, item.fontScale)
+                << "\" fill=\"" << color << "\">" << svgEscape(item.text) << "</text>\n";
+            break;
+        }
+        }
+    }
+
+    svg << "</svg>\n";
+    return static_cast<bool>(svg);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <string>
+#include <vector>
+
+// ------- VECTOR OVERLAY ------- //
+// Annotations are kept as vector primitives in native frame coordinates and only rasterized at the end:
+// either once onto a single upsampled copy of the frame, or written as SVG on top of the native-resolution
+// frame. Sizes that should look the same at any zoom (line widths, radii, label offsets, dash pattern)
+// are given in output pixels.
+
+enum class OverlayKind { Polyline, Circle, Text };
+
+struct OverlayPrimitive {
+    OverlayKind kind = OverlayKind::Polyline;
+    std::vector<cv::Point2f> points;   // Polyline vertices, circle center or text anchor (native px)
+    bool closed = false;               // Polyline: connect last and first vertex
+    bool dashed = false;               // Polyline: 10 px dash / 5 px gap
+    float radius = 0;                  // Circle radius (output px)
+    std::string text;
+    cv::Point2f offset;                // Text origin relative to the anchor (output px)
+    int fontFace = cv::FONT_HERSHEY_PLAIN;
+    double fontScale = 1.0;
+    cv::Scalar color;
+    int thickness = 1;                 // Output px, FILLED for filled circles
+};
+
+class Overlay {
+public:
+    void polyline(const std::vector<cv::Point2f>& points, bool closed, const cv::Scalar& color, int thickness, bool dashed = false);
+    void line(cv::Point2f from, cv::Point2f to, const cv::Scalar& color, int thickness, bool dashed = false);
+    void circle(cv::Point2f center, float radius, const cv::Scalar& color, int thickness);
+    void text(const std::string& text, cv::Point2f anchor, cv::Point2f offset, int fontFace, double fontScale,
+              const cv::Scalar& color, int thickness);
+
+    // Polyline clipped to a native rectangle before it is stored: only the visible pieces are kept
+    void clippedPolyline(const std::vector<cv::Point2f>& points, const cv::Rect2f& clip, const cv::Scalar& color, int thickness);
+
+    const std::vector<OverlayPrimitive>& primitives() const { return items; }
+
+    // Upsamples the frame once by scale and draws all primitives on it
+    cv::Mat render(const cv::Mat& frame, double scale) const;
+
+    // SVG document of size nativeSize * scale: the image at imageHref stretched to the full size, the
+    // primitives on top as vector graphics. Returns false if the file cannot be written.
+    bool writeSvg(const std::string& path, const std::string& imageHref, cv::Size nativeSize, double scale) const;
+
+private:
+    std::vector<OverlayPrimitive> items;
+};
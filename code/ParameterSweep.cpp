@@ -0,0 +1,269 @@
+#include "ParameterSweep.h"
+#include "FrameProcessing.h"
+#include "FrameSource.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const int kStripeWidth = 64;   // Columns per parallel work item
+
+double median(vector<double> values) {
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 == 0 ? 0.5 * (values[n / 2 - 1] + values[n / 2]) : values[n / 2];
+}
+
+} // namespace
+
+vector<int> SweepRange::values() const {
+    vector<int> list;
+    if (step <= 0) return list;
+    for (int v = from; v <= to; v += step) list.push_back(v);
+    return list;
+}
+
+ParameterSweep::ParameterSweep(const vector<int>& cutoffs) : sortedCutoffs(cutoffs), histogram(256, 0.0) {
+    sort(sortedCutoffs.begin(), sortedCutoffs.end());
+    sortedCutoffs.erase(unique(sortedCutoffs.begin(), sortedCutoffs.end()), sortedCutoffs.end());
+    tops.resize(sortedCutoffs.size());
+}
+
+int ParameterSweep::effectiveCutoff(int brightness, int threshold) {
+    return pickCutoff(brightness, threshold);
+}
+
+void ParameterSweep::addFrame(const Mat& gray, int ignoreTop, int cutoffRow) {
+    CV_Assert(gray.type() == CV_8UC1);
+    if (width != gray.cols) {
+        width = gray.cols;
+        for (auto& top : tops) top.assign(width, AzimuthEnvelope::kEmpty);
+    }
+
+    const int startRow = max(0, ignoreTop);
+    const int endRow = cutoffRow < 0 ? gray.rows : min(cutoffRow, gray.rows);
+    if (startRow >= endRow) return;
+
+    // Band histogram for the Otsu default (every second row and column is plenty)
+    for (int y = startRow; y < endRow; y += 2) {
+        const uchar* row = gray.ptr<uchar>(y);
+        for (int x = 0; x < gray.cols; x += 2) histogram[row[x]] += 1.0;
+    }
+
+    // Cutoffs of 255 never see foreground
+    const int resolvable = static_cast<int>(lower_bound(sortedCutoffs.begin(), sortedCutoffs.end(), 255) - sortedCutoffs.begin());
+    if (resolvable == 0) return;
+
+    const int stripes = (width + kStripeWidth - 1) / kStripeWidth;
+    parallel_for_(Range(0, stripes), [&](const Range& range) {
+        int runningMax[kStripeWidth];
+        int resolved[kStripeWidth];   // Cutoffs (ascending) already below the running maximum
+
+        for (int s = range.start; s < range.end; ++s) {
+            const int x0 = s * kStripeWidth;
+            const int n = min(kStripeWidth, width - x0);
+            fill(runningMax, runningMax + n, -1);
+            fill(resolved, resolved + n, 0);
+            int open = n;             // Columns with cutoffs still waiting for their first row
+
+            for (int y = startRow; y < endRow && open > 0; ++y) {
+                const uchar* row = gray.ptr<uchar>(y) + x0;
+                for (int i = 0; i < n; ++i) {
+                    int g = row[i];
+                    if (g <= runningMax[i]) continue;
+                    runningMax[i] = g;
+
+                    // Every cutoff below the new maximum has its first foreground row here
+                    int k = resolved[i];
+                    if (k == resolvable) continue;
+                    for (; k < resolvable && sortedCutoffs[k] < g; ++k) {
+                        unsigned short& top = tops[k][x0 + i];
+                        top = min(top, static_cast<unsigned short>(y));
+                    }
+                    if (k == resolvable) --open;
+                    resolved[i] = k;
+                }
+            }
+        }
+    });
+}
+
+AzimuthEnvelope ParameterSweep::envelope(size_t index) const {
+    AzimuthEnvelope result;
+    result.assign(tops[index]);
+    return result;
+}
+
+int ParameterSweep::otsuCutoff() const {
+    double total = 0.0, weightedTotal = 0.0;
+    for (int v = 0; v < 256; ++v) {
+        total += histogram[v];
+        weightedTotal += v * histogram[v];
+    }
+    if (total == 0.0) return -1;
+
+    // Maximum between-class variance; class 0 = values <= t (background), class 1 = values > t
+    double background = 0.0, weightedBackground = 0.0, bestVariance = -1.0;
+    int best = 0;
+    for (int t = 0; t < 255; ++t) {
+        background += histogram[t];
+        weightedBackground += t * histogram[t];
+        double foreground = total - background;
+        if (background == 0.0 || foreground == 0.0) continue;
+        double meanBackground = weightedBackground / background;
+        double meanForeground = (weightedTotal - weightedBackground) / foreground;
+        double variance = background * foreground * (meanBackground - meanForeground) * (meanBackground - meanForeground);
+        if (variance > bestVariance) {
+            bestVariance = variance;
+            best = t;
+        }
+    }
+    return best;
+}
+
+SweepCandidate ParameterSweep::score(const AzimuthEnvelope& envelope, float baselineY, int ignoreTop, int neighborhood) {
+    SweepCandidate candidate;
+    const int covered = envelope.coveredColumns();
+    if (covered == 0) return candidate;
+    candidate.coverage = static_cast<double>(covered) / envelope.width();
+
+    int atTopMask = 0;
+    for (unsigned short row : envelope.rows()) atTopMask += row != AzimuthEnvelope::kEmpty && row <= ignoreTop;
+
+    // Red dots: outline corners, the highest one per neighbourhood
+    vector<Point> dots;
+    for (const auto& run : envelope.outline()) {
+        for (const Point& pt : AzimuthEnvelope::corners(run, baselineY)) dots.push_back(pt);
+    }
+    sort(dots.begin(), dots.end(), [](const Point& a, const Point& b) { return a.y < b.y || (a.y == b.y && a.x < b.x); });
+    vector<int> kept;
+    for (const Point& pt : dots) {
+        bool near = false;
+        for (int x : kept) near = near || std::abs(x - pt.x) < neighborhood;
+        if (!near) kept.push_back(pt.x);
+    }
+    candidate.redDots = static_cast<int>(kept.size());
+    if (kept.size() < 3) return candidate;
+
+    // Regularity of the spacings: picks sit on a fixed pitch, noise does not
+    sort(kept.begin(), kept.end());
+    vector<double> spacings;
+    for (size_t i = 1; i < kept.size(); ++i) spacings.push_back(kept[i] - kept[i - 1]);
+    double medianSpacing = median(spacings);
+    vector<double> deviations;
+    for (double s : spacings) deviations.push_back(std::abs(s - medianSpacing));
+    double mad = median(deviations);
+    for (double d : deviations) candidate.regularSpacings += d <= 2 * mad;
+
+    double spread = medianSpacing > 0 ? mad / medianSpacing : 1.0;
+    candidate.score = candidate.regularSpacings * max(0.0, 1.0 - spread) * (1.0 - static_cast<double>(atTopMask) / covered);
+    return candidate;
+}
+
+SweepResult ParameterSweep::run(const SweepOptions& options, int defaultBrightness, ostream& console) {
+    SweepResult result;
+    VideoCapture cap(options.videoPath);
+    if (!cap.isOpened()) {
+        console << "Error: Cannot open video file " << options.videoPath << endl;
+        return result;
+    }
+
+    // ------- GRID ------- //
+    vector<SweepCandidate> grid;
+    vector<int> cutoffs;
+    for (int b : options.brightness.values()) {
+        for (int t : options.threshold.values()) {
+            SweepCandidate candidate;
+            candidate.brightness = b;
+            candidate.threshold = t;
+            candidate.cutoff = effectiveCutoff(b, t);
+            grid.push_back(candidate);
+            cutoffs.push_back(candidate.cutoff);
+        }
+    }
+    if (grid.empty()) {
+        console << "Error: Empty sweep grid." << endl;
+        return result;
+    }
+    ParameterSweep sweep(cutoffs);
+
+    // ------- ONE DECODE, ALL CANDIDATES ------- //
+    int64 startTicks = getTickCount();
+    VideoFileSource source(cap, options.lumaDecode);
+    Mat frame, gray;
+    double timestampMs;
+    int ignoreTop = 0;
+    while ((options.maxFrames <= 0 || result.frames < options.maxFrames) && source.read(frame, timestampMs)) {
+        // Same blurred gray and baseline merge as the pipeline workers and the consumer
+        int detectedY = detectBaselineRow(frame, gray);
+        if (detectedY != -1 && (result.baselineY == -1 || detectedY < result.baselineY)) {
+            result.baselineY = baselineFromRow(detectedY);
+        }
+        ignoreTop = static_cast<int>(0.1 * gray.rows);
+        sweep.addFrame(gray, ignoreTop, baselineCutoffRow(result.baselineY));
+        ++result.frames;
+    }
+    double seconds = (getTickCount() - startTicks) / getTickFrequency();
+    if (result.frames == 0) {
+        console << "Error: No frames decoded from " << options.videoPath << endl;
+        return result;
+    }
+
+    // ------- SCORING ------- //
+    vector<SweepCandidate> scored(sweep.cutoffs().size());
+    for (size_t i = 0; i < scored.size(); ++i) {
+        scored[i] = score(sweep.envelope(i), result.baselineY, ignoreTop, options.neighborhood);
+    }
+    for (SweepCandidate& candidate : grid) {
+        size_t index = lower_bound(sweep.cutoffs().begin(), sweep.cutoffs().end(), candidate.cutoff) - sweep.cutoffs().begin();
+        SweepCandidate measured = scored[index];
+        measured.brightness = candidate.brightness;
+        measured.threshold = candidate.threshold;
+        measured.cutoff = candidate.cutoff;
+        candidate = measured;
+    }
+    stable_sort(grid.begin(), grid.end(), [](const SweepCandidate& a, const SweepCandidate& b) { return a.score > b.score; });
+    result.candidates = grid;
+
+    result.otsuCutoff = sweep.otsuCutoff();
+    result.otsuBrightness = defaultBrightness;
+    result.otsuThreshold = min(255, result.otsuCutoff + defaultBrightness);
+
+    // ------- REPORT ------- //
+    console << "[SWEEP] " << options.videoPath << ": " << result.frames << " frames, " << grid.size() << " settings ("
+            << sweep.cutoffs().size() << " distinct cutoffs) in " << seconds << " s" << endl;
+    console << "  brightness  threshold  cutoff   score  red dots  regular  coverage" << endl;
+    for (size_t i = 0; i < grid.size() && i < 10; ++i) {
+        const SweepCandidate& c = grid[i];
+        char line[128];
+        snprintf(line, sizeof(line), "  %10d  %9d  %6d  %6.2f  %8d  %7d  %7.0f%%",
+                 c.brightness, c.threshold, c.cutoff, c.score, c.redDots, c.regularSpacings, 100.0 * c.coverage);
+        console << line << endl;
+    }
+
+    console << "Otsu default: brightness " << result.otsuBrightness << ", threshold " << result.otsuThreshold
+            << " (cutoff " << result.otsuCutoff << ")" << endl;
+    if (grid.front().score > 0) {
+        console << "Best setting: brightness " << grid.front().brightness << ", threshold " << grid.front().threshold
+                << " (score " << grid.front().score << ")" << endl;
+    }
+    else {
+        console << "No setting produced regular red dots; use the Otsu default." << endl;
+    }
+
+    if (!options.csvPath.empty()) {
+        ofstream csv(options.csvPath);
+        csv << "brightness,threshold,cutoff,score,red_dots,regular_spacings,coverage\n";
+        for (const SweepCandidate& c : grid) {
+            csv << c.brightness << "," << c.threshold << "," << c.cutoff << "," << c.score << "," << c.redDots << ","
+                << c.regularSpacings << "," << c.coverage << "\n";
+        }
+        console << "Ranking written to " << options.csvPath << endl;
+    }
+    return result;
+}
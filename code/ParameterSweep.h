@@ -0,0 +1,86 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AzimuthEnvelope.h"
+
+// ------- PARAMETER SWEEP ------- //
+// Brightness + binary threshold of the pick mask reduce to one effective gray cutoff: with the
+// saturating add, min(255, gray + brightness) > threshold holds exactly when gray > threshold -
+// brightness (and never for threshold >= 255). The sweep therefore keeps one azimuth envelope per
+// distinct cutoff and fills all of them from one scan of each decoded frame: walking a column top-down,
+// its running maximum gray value is a staircase, and the first row where it exceeds a cutoff is that
+// cutoff's envelope row. Columns are split into stripes processed in parallel.
+//
+// Every envelope is scored on how regular its red dots are, and an Otsu cutoff of the pick band
+// histogram is reported as the automatic default.
+
+struct SweepRange {
+    int from = 0;
+    int to = 0;
+    int step = 1;
+
+    std::vector<int> values() const;
+};
+
+struct SweepOptions {
+    std::string videoPath;                 // --sweep <video>
+    SweepRange brightness{ 0, 40, 5 };     // --sweep-brightness from:to:step
+    SweepRange threshold{ 60, 200, 5 };    // --sweep-threshold from:to:step
+    long long maxFrames = 0;               // --sweep-frames N : stop after N frames (0 = whole video)
+    bool lumaDecode = false;               // --luma : decode the Y plane only
+    int neighborhood = 20;                 // Red dot merge distance (native px, 80 zoomed px)
+    std::string csvPath;                   // Full ranking as CSV ("" = console only)
+};
+
+struct SweepCandidate {
+    int brightness = 0;
+    int threshold = 0;
+    int cutoff = 0;                        // Effective gray cutoff (threshold - brightness, 255 = nothing)
+    double score = 0.0;
+    int redDots = 0;                       // Red dots after merging close ones
+    int regularSpacings = 0;               // Red dot spacings within 2 MAD of the median
+    double coverage = 0.0;                 // Fraction of columns with foreground
+};
+
+struct SweepResult {
+    std::vector<SweepCandidate> candidates;   // Best score first
+    long long frames = 0;
+    float baselineY = -1;
+    int otsuCutoff = -1;                       // Automatic default: Otsu cutoff of the pick band
+    int otsuBrightness = 0;                    // ... expressed with the default brightness
+    int otsuThreshold = 0;
+};
+
+class ParameterSweep {
+public:
+    // cutoffs: effective cutoffs to accumulate (any order, duplicates are merged)
+    explicit ParameterSweep(const std::vector<int>& cutoffs);
+
+    static int effectiveCutoff(int brightness, int threshold);
+
+    // Merges one blurred gray frame into every envelope (rows [ignoreTop, cutoffRow), cutoffRow -1 = all)
+    // and into the band histogram
+    void addFrame(const cv::Mat& gray, int ignoreTop, int cutoffRow);
+
+    const std::vector<int>& cutoffs() const { return sortedCutoffs; }
+    // Envelope of cutoffs()[index]
+    AzimuthEnvelope envelope(size_t index) const;
+    // Otsu threshold of the accumulated band histogram, -1 before the first frame
+    int otsuCutoff() const;
+
+    // Red dot regularity of an envelope: regular spacings x (1 - relative MAD), scaled down by the
+    // fraction of columns that reach the top mask (background let through by a too low cutoff)
+    static SweepCandidate score(const AzimuthEnvelope& envelope, float baselineY, int ignoreTop, int neighborhood);
+
+    // Decodes the video once, sweeps the grid and prints the ranking. Returns an empty result if the
+    // video cannot be read.
+    static SweepResult run(const SweepOptions& options, int defaultBrightness, std::ostream& console);
+
+private:
+    std::vector<int> sortedCutoffs;
+    std::vector<std::vector<unsigned short>> tops;   // [cutoff][column]
+    std::vector<double> histogram;                   // Gray values of the pick band, all frames
+    int width = 0;
+};
@@ -0,0 +1,221 @@
+#include "PickTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+double TrackedPick::trendPerHour() const {
+    double n = static_cast<double>(passages);
+    double denominator = n * sumTT - sumT * sumT;
+    if (passages < 2 || denominator <= 1e-12) return 0.0;
+    return (n * sumTH - sumT * sumH) / denominator;
+}
+
+PickTracker::PickTracker(const TrackerConfig& trackerConfig) : config(trackerConfig) {
+}
+
+void PickTracker::refreshLanes(const AzimuthEnvelope& envelope, float baselineY, const AnalyzerParams& params) {
+    // Red dots and cutting line spacing, exactly as a click would compute them from this contour
+    AnalysisResult geometry;
+    geometry.baselineY = baselineY;
+    geometry.scale = params.scale;
+    geometry.azimuthContour = envelope.outline();
+    FrameAnalyzer::findAzimuthPicks(geometry, params);
+    FrameAnalyzer::estimateCuttingLines(geometry);
+    if (geometry.cuttingSpacing <= 0) return;   // Fewer than two red dots: keep the lanes we have
+
+    vector<PickMeasurement>& dots = geometry.azimuthPicks;
+    sort(dots.begin(), dots.end(), [](const PickMeasurement& a, const PickMeasurement& b) {
+        return a.position.x < b.position.x;
+    });
+
+    // A lane keeps its id (and its picks) while its red dot stays within half a spacing
+    const int half = geometry.cuttingSpacing / 2;
+    const int scale = params.scale;
+    vector<Lane> fresh;
+    vector<bool> kept(lanes.size(), false);
+    for (const auto& dot : dots) {
+        int match = -1;
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            int distance = abs(lanes[i].centerX - dot.position.x);
+            if (!kept[i] && distance <= half && (match == -1 || distance < abs(lanes[match].centerX - dot.position.x))) {
+                match = static_cast<int>(i);
+            }
+        }
+
+        Lane lane;
+        if (match != -1) {
+            kept[match] = true;
+            lane = lanes[match];
+        }
+        else {
+            lane.id = nextLaneId++;
+        }
+        lane.centerX = dot.position.x;
+        lane.redDot = dot.position;
+        lane.firstColumn = max(0, (dot.position.x - half) / scale);
+        lane.endColumn = min(envelope.width(), (dot.position.x + half) / scale + 1);
+        fresh.push_back(lane);
+    }
+
+    // Lanes whose red dot is gone end their passage; their picks keep the statistics
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        if (!kept[i] && lanes[i].pick != -1) endPassage(lanes[i]);
+    }
+    lanes.swap(fresh);
+    ++eventCount;
+}
+
+int PickTracker::pickFor(Lane& lane, long long frameIndex, int period, double timestampMs) {
+    int phase = period > 0 ? static_cast<int>(frameIndex % period) : -1;
+
+    // Without a period a lane is one pick
+    if (phase == -1 && !lane.picks.empty()) return lane.picks.front();
+
+    if (phase != -1) {
+        // Nearest pick of the lane in the turn (circular distance)
+        int best = -1, bestDistance = config.phaseTolerance + 1, unphased = -1;
+        for (int index : lane.picks) {
+            const TrackedPick& pick = pickList[index];
+            if (pick.phase == -1) {
+                unphased = index;
+                continue;
+            }
+            int distance = abs(pick.phase - phase);
+            distance = min(distance, period - distance);
+            if (distance < bestDistance) {
+                best = index;
+                bestDistance = distance;
+            }
+        }
+        // A pick seen before the period was known takes the first phase
+        if (best == -1) best = unphased;
+        if (best != -1) {
+            pickList[best].phase = phase;   // Follows a slowly drifting period
+            return best;
+        }
+    }
+
+    TrackedPick pick;
+    pick.id = static_cast<int>(pickList.size());
+    pick.lane = lane.id;
+    pick.phase = phase;
+    pick.firstSeenMs = timestampMs;
+    pickList.push_back(pick);
+    lane.picks.push_back(pick.id);
+    ++eventCount;
+    return pick.id;
+}
+
+void PickTracker::endPassage(Lane& lane) {
+    TrackedPick& pick = pickList[lane.pick];
+    double h = lane.peak;
+    double t = (lane.peakMs - pick.firstSeenMs) / 3.6e6;   // Hours
+
+    pick.meanHeight = pick.passages == 0 ? h : pick.meanHeight + config.meanAlpha * (h - pick.meanHeight);
+    pick.maxHeight = pick.passages == 0 ? lane.peak : max(pick.maxHeight, lane.peak);
+    pick.lastHeight = lane.peak;
+    pick.lastSeenMs = lane.peakMs;
+    ++pick.passages;
+    pick.sumT += t;
+    pick.sumH += h;
+    pick.sumTT += t * t;
+    pick.sumTH += t * h;
+
+    lane.pick = -1;
+}
+
+void PickTracker::observe(long long frameIndex, double timestampMs, const vector<unsigned short>& tops,
+                          const AzimuthEnvelope& envelope, float baselineY, int changedColumns, int period,
+                          const AnalyzerParams& params) {
+    tips.clear();
+
+    // The lanes follow the contour while it still grows; once it converged they stay put
+    bool stale = changedColumns > 0 || baselineY != lanesBaseline;
+    if (!lanesValid || (stale && frameIndex - lanesFrame >= config.geometryEvery)) {
+        refreshLanes(envelope, baselineY, params);
+        lanesValid = true;
+        lanesFrame = frameIndex;
+        lanesBaseline = baselineY;
+    }
+    if (baselineY == -1) return;   // Heights need a baseline
+
+    const int scale = params.scale;
+    const int zoomedBaselineY = static_cast<int>(baselineY * scale);
+    const int width = static_cast<int>(tops.size());
+    const unsigned short endRow = static_cast<unsigned short>(baselineY);   // A worker may have masked below it
+
+    for (Lane& lane : lanes) {
+        // Highest foreground column of the frame inside the lane
+        int tipX = -1;
+        unsigned short tipY = AzimuthEnvelope::kEmpty;
+        for (int x = lane.firstColumn, end = min(lane.endColumn, width); x < end; ++x) {
+            if (tops[x] < tipY && tops[x] < endRow) {
+                tipY = tops[x];
+                tipX = x;
+            }
+        }
+
+        Point tip(tipX * scale, tipY * scale);
+        bool inAzimuth = tipX != -1 && norm(tip - lane.redDot) <= params.maxMatchDist;
+        if (!inAzimuth) {
+            if (lane.pick != -1) endPassage(lane);
+            continue;
+        }
+
+        // A gap of a frame starts a new passage
+        if (lane.pick != -1 && frameIndex > lane.lastFrame + 1) endPassage(lane);
+        int height = zoomedBaselineY - tip.y;
+        if (lane.pick == -1) {
+            lane.pick = pickFor(lane, frameIndex, period, timestampMs);
+            lane.peak = height;
+            lane.peakMs = timestampMs;
+        }
+        else if (height > lane.peak) {
+            lane.peak = height;
+            lane.peakMs = timestampMs;
+        }
+        lane.lastFrame = frameIndex;
+
+        TrackedTip tracked;
+        tracked.pick = lane.pick;
+        tracked.position = tip;
+        tracked.height = height;
+        tips.push_back(tracked);
+    }
+}
+
+void PickTracker::finish() {
+    for (Lane& lane : lanes) {
+        if (lane.pick != -1) endPassage(lane);
+    }
+    tips.clear();
+}
+
+void PickTracker::writeCsv(ostream& out) const {
+    out << "id,lane,phase,passages,max_height,mean_height,last_height,trend_px_per_hour,first_seen_ms,last_seen_ms\n";
+    for (const auto& pick : pickList) {
+        if (pick.passages == 0) continue;
+        out << pick.id << "," << pick.lane << "," << pick.phase << "," << pick.passages << "," << pick.maxHeight << ","
+            << fixed << setprecision(2) << pick.meanHeight << "," << pick.lastHeight << "," << pick.trendPerHour() << ","
+            << setprecision(1) << pick.firstSeenMs << "," << pick.lastSeenMs << "\n";
+        out.unsetf(ios::floatfield);
+    }
+}
+
+void PickTracker::report(ostream& console) const {
+    int tracked = 0;
+    for (const auto& pick : pickList) tracked += pick.passages > 0;
+    streamsize precision = console.precision();
+    console << "\n[TRACK] " << tracked << " pick(s) in " << lanes.size() << " lane(s) (heights in zoomed px):" << endl;
+    for (const auto& pick : pickList) {
+        if (pick.passages == 0) continue;
+        console << "  #" << pick.id << " lane " << pick.lane << (pick.phase >= 0 ? " phase " + to_string(pick.phase) : string())
+                << ": " << pick.passages << " passage(s), max " << pick.maxHeight << ", mean " << fixed << setprecision(1)
+                << pick.meanHeight << ", last " << pick.lastHeight << ", trend " << pick.trendPerHour() << " px/h" << endl;
+        console.unsetf(ios::floatfield);
+    }
+    console.precision(precision);
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <ostream>
+#include <vector>
+#include "AzimuthEnvelope.h"
+#include "FrameAnalyzer.h"
+
+// ------- PICK TRACKER ------- //
+// Continuous version of the click's tip / azimuth match: runs on every analyzed frame and follows each
+// pick over the whole recording.
+//
+// Lanes: every red dot of the azimuth contour is the azimuth of one pick line, and the cutting line
+// spacing is its width. The lanes are refreshed from the contour while it still changes (at most every
+// geometryEvery frames) and keep their identity by position. Tips: the highest foreground column of
+// the frame's top rows (FramePacket::tops) inside each lane, matched to the lane's red dot within
+// maxMatchDist like the click analysis. That is O(width) per frame, without contours.
+//
+// Identity: a pick is in azimuth for a few consecutive frames once per drum turn (a passage). With a
+// known rotation period the passages of one lane are told apart by their phase in the turn (the frame
+// index of the passage start modulo the period, within phaseTolerance frames); without one every lane
+// is a single pick. Each finished passage updates its pick's statistics in O(1): maximum height at
+// azimuth, rolling mean and the least-squares wear trend over time. Heights are in zoomed px.
+
+struct TrackerConfig {
+    bool enabled = false;             // --track : per-frame pick tracking
+    int geometryEvery = 15;           // Frames between lane refreshes while the azimuth contour changes
+    int phaseTolerance = 3;           // --track-tolerance N : drift (frames) of a pick's passage within the turn
+    double meanAlpha = 0.2;           // Weight of the newest passage in the rolling mean height
+};
+
+// Statistics of one physical pick
+struct TrackedPick {
+    int id = 0;
+    int lane = 0;                     // Lane id (pick line)
+    int phase = -1;                   // Frame of the turn its passage starts at (-1 = period unknown)
+    long long passages = 0;           // Passages through azimuth seen
+    int maxHeight = 0;                // Highest tip at azimuth (zoomed px above the baseline)
+    int lastHeight = 0;               // Peak of the latest passage
+    double meanHeight = 0.0;          // Rolling (exponential) mean of the passage peaks
+    double firstSeenMs = 0.0;
+    double lastSeenMs = 0.0;
+
+    // Wear trend: least-squares slope of the passage peaks over time, from running sums
+    double sumT = 0.0, sumH = 0.0, sumTT = 0.0, sumTH = 0.0;   // t in hours since firstSeenMs
+    double trendPerHour() const;
+};
+
+// A pick tip in azimuth on the last observed frame
+struct TrackedTip {
+    int pick = -1;                    // Index into PickTracker::picks()
+    cv::Point position;               // Zoomed px
+    int height = 0;                   // Zoomed px above the baseline
+};
+
+class PickTracker {
+public:
+    explicit PickTracker(const TrackerConfig& config = TrackerConfig());
+
+    bool enabled() const { return config.enabled; }
+
+    // Tracks the tips of one analyzed frame (frames in decode order). tops: the frame's top row per
+    // column (native px, AzimuthEnvelope::kEmpty = none); envelope / baselineY: the accumulated state
+    // after merging the frame; changedColumns: envelope columns the frame moved; period: rotation period
+    // in frames (0 = unknown).
+    void observe(long long frameIndex, double timestampMs, const std::vector<unsigned short>& tops,
+                 const AzimuthEnvelope& envelope, float baselineY, int changedColumns, int period,
+                 const AnalyzerParams& params);
+    // The contour was rebuilt (new trackbar values): refresh the lanes on the next frame
+    void invalidateLanes() { lanesValid = false; }
+    // Ends the open passages (end of the video / stream)
+    void finish();
+
+    const std::vector<TrackedPick>& picks() const { return pickList; }
+    const std::vector<TrackedTip>& currentTips() const { return tips; }
+    // Lane refreshes + picks created so far: changes when the tracker allocated (allocation check)
+    long long events() const { return eventCount; }
+
+    // One CSV row per pick; a summary table on the console
+    void writeCsv(std::ostream& out) const;
+    void report(std::ostream& console) const;
+
+private:
+    struct Lane {
+        int id = 0;
+        int centerX = 0;              // Red dot x (zoomed px)
+        cv::Point redDot;             // Zoomed px
+        int firstColumn = 0;          // Native columns [firstColumn, endColumn) scanned for its tip
+        int endColumn = 0;
+        std::vector<int> picks;       // Indices into pickList
+
+        // Open passage
+        int pick = -1;                // -1 = not in azimuth
+        long long lastFrame = -1;     // Last frame of the passage
+        int peak = 0;
+        double peakMs = 0.0;
+    };
+
+    void refreshLanes(const AzimuthEnvelope& envelope, float baselineY, const AnalyzerParams& params);
+    int pickFor(Lane& lane, long long frameIndex, int period, double timestampMs);
+    void endPassage(Lane& lane);
+
+    TrackerConfig config;
+    std::vector<Lane> lanes;          // Sorted by centerX
+    std::vector<TrackedPick> pickList;
+    std::vector<TrackedTip> tips;
+    bool lanesValid = false;
+    long long lanesFrame = -1;        // Frame of the last lane refresh
+    float lanesBaseline = -1;
+    int nextLaneId = 0;
+    long long eventCount = 0;
+};
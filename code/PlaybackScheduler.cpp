@@ -0,0 +1,74 @@
+#include "PlaybackScheduler.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+PlaybackScheduler::PlaybackScheduler(const PlaybackConfig& playbackConfig, double sourceFps)
+    : config(playbackConfig), frameIntervalMs(sourceFps > 0 ? 1000.0 / sourceFps : 1000.0 / 30.0) {
+}
+
+double PlaybackScheduler::nowMs() const {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void PlaybackScheduler::anchor(double now, double mediaMs) {
+    if (anchored) {
+        ++resyncCount;
+        if (config.telemetry) config.telemetry->count(Counter::ClockResyncs);
+    }
+    anchored = true;
+    anchorWallMs = now;
+    anchorMediaMs = mediaMs;
+    lastShownWallMs = -1;             // Show the first frame after the jump
+}
+
+bool PlaybackScheduler::beginFrame(long long frameIndex, double timestampMs) {
+    double now = nowMs();
+
+    // Media time of the frame: its timestamp, or its index at the source rate if the source gives none
+    double mediaMs = timestampMs > 0 || frameIndex == 0 ? timestampMs : frameIndex * frameIntervalMs;
+
+    // Looped / seeked video (media time jumps back) or a lag beyond the limit: restart the clock here
+    dueMs = anchorWallMs + (mediaMs - anchorMediaMs);
+    if (!anchored || mediaMs < lastMediaMs || abs(now - dueMs) > config.maxLagMs) {
+        anchor(now, mediaMs);
+        dueMs = now;
+    }
+    lastMediaMs = mediaMs;
+    lateMs = now - dueMs;
+    bool late = config.policy != LatePolicy::None && lateMs > frameIntervalMs;
+
+    // Analysis policy: halve the analyzed frames while late, back to full rate once on time
+    if (config.policy == LatePolicy::Analysis) {
+        if (late) cadence = min(cadence * 2, max(1, config.maxAnalysisCadence));
+        else if (lateMs <= 0) cadence = max(1, cadence / 2);
+    }
+
+    // Display rate cap in media time (half a frame of slack, so 30 fps footage is not thinned by a 30 fps cap)
+    bool show = lastShownWallMs < 0 || config.maxDisplayFps <= 0 ||
+                mediaMs - lastShownMediaMs >= 1000.0 / config.maxDisplayFps - frameIntervalMs / 2;
+    if (show && late && lastShownWallMs >= 0 && now - lastShownWallMs < kMaxDisplayGapMs) {
+        show = false;
+        if (config.telemetry) config.telemetry->count(Counter::DisplaySkipped);
+    }
+    if (show) {
+        lastShownMediaMs = mediaMs;
+        lastShownWallMs = now;
+    }
+    return show;
+}
+
+int PlaybackScheduler::waitMs() const {
+    if (!config.paced) return 1;
+    double remaining = dueMs + frameIntervalMs - nowMs();
+    return static_cast<int>(min(max(remaining, 1.0), config.maxLagMs));
+}
+
+Size PlaybackScheduler::previewSize(Size frameSize) const {
+    if (config.previewWidth <= 0 || frameSize.width <= config.previewWidth) return frameSize;
+    double scale = static_cast<double>(config.previewWidth) / frameSize.width;
+    return Size(config.previewWidth, max(1, static_cast<int>(lround(frameSize.height * scale))));
+}
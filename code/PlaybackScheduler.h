@@ -0,0 +1,72 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <chrono>
+
+class Telemetry;
+
+// ------- PLAYBACK SCHEDULER ------- //
+// Real-time pacing of the player from the frame timestamps instead of a fixed waitKey(30). The first
+// frame anchors media time to the wall clock, every later frame is due at its timestamp on that clock
+// (frame index / CAP_PROP_FPS while the source gives no timestamps), and the player waits only for the
+// time left until the next frame is due. A frame more than one frame interval late is still accumulated
+// but not displayed; with LatePolicy::Analysis the per-frame analysis cadence is also raised until the
+// player has caught up. Displayed frames are capped at maxDisplayFps and shown at preview size.
+// A due time further than maxLagMs from the wall clock (a looped or seeked video, or a consumer that
+// cannot keep up even without display) re-anchors the clock, so the lag stays bounded.
+
+enum class LatePolicy {
+    None,             // Show every frame; the lag grows under load
+    Display,          // Skip the display of late frames; every frame is still accumulated
+    Analysis,         // Also analyze only every N-th frame while late
+};
+
+struct PlaybackConfig {
+    LatePolicy policy = LatePolicy::Display;  // --late <none|display|analysis>
+    bool paced = true;                // Wait for the due time of each frame (streams: the producer sets the pace)
+    double maxDisplayFps = 30.0;      // --display-fps N : displayed frames per second at most (0 = every frame)
+    int previewWidth = 1280;          // --preview-width N : display width of wider frames (0 = native)
+    double maxLagMs = 1000.0;         // Distance between due time and wall clock that re-anchors the clock
+    int maxAnalysisCadence = 8;       // LatePolicy::Analysis: analyze at least every N-th frame while late
+    Telemetry* telemetry = nullptr;   // Skipped displays and clock re-anchors (optional)
+};
+
+class PlaybackScheduler {
+public:
+    // sourceFps: CAP_PROP_FPS of the video (0 = unknown, 30 assumed)
+    PlaybackScheduler(const PlaybackConfig& config, double sourceFps);
+
+    // Next frame in decode order: returns true if it is to be displayed
+    bool beginFrame(long long frameIndex, double timestampMs);
+    // Milliseconds to pump GUI events (waitKey) until the next frame is due, at least 1
+    int waitMs() const;
+
+    // Per-frame analysis cadence the player can afford right now (1 = every frame)
+    int analysisCadence() const { return cadence; }
+    // How far the current frame is behind its due time (negative = early)
+    double lagMs() const { return lateMs; }
+    long long resyncs() const { return resyncCount; }
+
+    // Display size of a frame: scaled down to previewWidth, aspect ratio kept
+    cv::Size previewSize(cv::Size frameSize) const;
+
+private:
+    static const int kMaxDisplayGapMs = 250;   // A late player still shows a frame this often
+
+    double nowMs() const;
+    void anchor(double now, double mediaMs);
+
+    PlaybackConfig config;
+    double frameIntervalMs;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    bool anchored = false;
+    double anchorWallMs = 0;          // Wall clock (ms since start) of the anchor frame
+    double anchorMediaMs = 0;         // Media time of the anchor frame
+    double lastMediaMs = 0;
+    double dueMs = 0;                 // Wall clock due time of the current frame
+    double lateMs = 0;
+    double lastShownMediaMs = 0;      // Media time of the last displayed frame
+    double lastShownWallMs = -1;
+    int cadence = 1;
+    long long resyncCount = 0;
+};
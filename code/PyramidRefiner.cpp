@@ -0,0 +1,145 @@
+#include "PyramidRefiner.h"
+#include "AzimuthEnvelope.h"
+#include "BaselineDetector.h"
+#include "FrameProcessing.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+const int PyramidRefiner::kMaxLevels;
+const int PyramidRefiner::kTileColumns;
+
+namespace {
+
+int ceilDiv(int value, int divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+} // namespace
+
+int PyramidRefiner::detectBaselineRow(const Mat& frame, bool detect, const Rect& roi, const PyramidConfig& config) {
+    const int depth = min(max(config.levels, 1), kMaxLevels);
+    const int s = 1 << depth;
+    const Rect frameRect(0, 0, frame.cols, frame.rows);
+    factor = s;
+    tolerance = max(0, config.tolerance);
+
+    // Region aligned to the level grid, so every coarse pixel covers whole s x s blocks
+    const Rect clipped = roi & frameRect;
+    region = Rect(Point(clipped.x / s * s, clipped.y / s * s),
+                  Point(min(frame.cols, ceilDiv(clipped.x + clipped.width, s) * s),
+                        min(frame.rows, ceilDiv(clipped.y + clipped.height, s) * s)));
+    coarseRegion = Rect(region.x / s, region.y / s, ceilDiv(region.width, s), ceilDiv(region.height, s));
+
+    // Raw gray of the region plus the 3 pixels the full-resolution blur and baseline kernels read around it
+    if (frame.channels() == 1) {
+        raw = frame;
+    }
+    else {
+        const Rect support = Rect(region.x - 3, region.y - 3, region.width + 6, region.height + 6) & frameRect;
+        if (rawBuffer.size() != frame.size()) rawBuffer.create(frame.size(), CV_8UC1);
+        Mat target = rawBuffer(support);
+        cvtColor(frame(support), target, COLOR_BGR2GRAY);
+        raw = rawBuffer;
+    }
+
+    // ------- PYRAMID LEVEL ------- //
+    level.create(ceilDiv(frame.rows, s), ceilDiv(frame.cols, s), CV_8UC1);
+    levels.resize(depth - 1);
+    Mat source = raw(region);
+    for (int l = 0; l < depth - 1; ++l) {
+        pyrDown(source, levels[l]);
+        source = levels[l];
+    }
+    Mat coarse = level(coarseRegion);
+    pyrDown(source, coarse, coarse.size());
+
+    // ------- BASELINE: COARSE CANDIDATE, FULL-RESOLUTION ROW ------- //
+    int detectedY = -1;
+    int coarseY = detect ? BaselineDetector::detectRow(level, coarseRegion) : -1;
+    if (coarseY != -1) {
+        // The coarse edge row covers rows [coarseY * s, (coarseY + 1) * s); one coarse row of slack on each
+        // side for the phase of the pyrDown kernel
+        const int top = (coarseY - 1) * s - tolerance;
+        const int bottom = (coarseY + 2) * s + tolerance;
+        detectedY = BaselineDetector::detectRow(raw, Rect(region.x, top, region.width, bottom - top) & region);
+    }
+
+    // The pick mask thresholds a sigma 2 blur; pyrDown already blurred with a variance of (4^depth - 1) / 3
+    // full-resolution px^2, the level gets the rest
+    levelGray.create(level.size(), CV_8UC1);
+    Mat blurred = levelGray(coarseRegion);
+    const double residual = 4.0 - ((1 << 2 * depth) - 1) / 3.0;
+    if (residual > 0) GaussianBlur(coarse, blurred, Size(5, 5), std::sqrt(residual) / s);
+    else coarse.copyTo(blurred);
+    return detectedY;
+}
+
+void PyramidRefiner::pickMask(int brightness, int threshold, int baselineCutoff, Mat& gray, Mat& binary,
+                              vector<unsigned short>& tops) {
+    CV_Assert(gray.size() == raw.size() && binary.size() == raw.size());
+    const int s = factor;
+    if (static_cast<int>(tops.size()) != gray.cols) tops.assign(gray.cols, AzimuthEnvelope::kEmpty);
+
+    // ------- CANDIDATES ON THE LEVEL ------- //
+    // A coarse row that is only partly above the cutoff is kept; the windows mask the exact rows
+    const int coarseCutoff = baselineCutoff == -1 ? -1 : ceilDiv(baselineCutoff, s);
+    levelTops.assign(level.cols, AzimuthEnvelope::kEmpty);
+    fusedPickMask(levelGray, brightness, threshold, coarseCutoff, levelBinary, levelTops, coarseRegion);
+
+    // Binary: the coarse mask over the whole blocks of the region (a partial block at the frame edge stays
+    // background), then the full-resolution band limits
+    const Rect blocks(coarseRegion.x, coarseRegion.y, region.width / s, region.height / s);
+    Mat columns = binary(region);
+    Mat upsampled = binary(Rect(region.x, region.y, blocks.width * s, blocks.height * s));
+    resize(levelBinary(blocks), upsampled, upsampled.size(), 0, 0, INTER_NEAREST);
+    if (upsampled.cols < region.width) columns.colRange(upsampled.cols, region.width).setTo(0);
+    if (upsampled.rows < region.height) columns.rowRange(upsampled.rows, region.height).setTo(0);
+
+    const int startY = max(static_cast<int>(0.1 * binary.rows), region.y);
+    const int endY = max(startY, min(baselineCutoff == -1 ? binary.rows : baselineCutoff, region.y + region.height));
+    if (region.y < startY) columns.rowRange(0, min(startY, region.y + region.height) - region.y).setTo(0);
+    if (endY < region.y + region.height) columns.rowRange(endY - region.y, region.height).setTo(0);
+    const Rect band(region.x, startY, region.width, endY - startY);
+
+    // ------- FULL-RESOLUTION WINDOWS AROUND THE COARSE TOPS ------- //
+    windowTops.assign(gray.cols, AzimuthEnvelope::kEmpty);
+    const int end = coarseRegion.x + coarseRegion.width;
+    for (int cx0 = coarseRegion.x; cx0 < end; cx0 += kTileColumns) {
+        const int cx1 = min(cx0 + kTileColumns, end);
+
+        // Coarse tops of the tile and one column on each side (a tip narrower than a coarse pixel may only
+        // show up in the neighbouring column)
+        int highest = AzimuthEnvelope::kEmpty, lowest = -1;
+        for (int cx = max(coarseRegion.x, cx0 - 1); cx < min(end, cx1 + 1); ++cx) {
+            if (levelTops[cx] == AzimuthEnvelope::kEmpty) continue;
+            highest = min(highest, static_cast<int>(levelTops[cx]));
+            lowest = max(lowest, static_cast<int>(levelTops[cx]));
+        }
+        if (lowest == -1) continue;
+
+        // One coarse row of slack plus the tolerance around the coarse tops
+        Rect window(Point(cx0 * s, (highest - 1) * s - tolerance), Point(cx1 * s, (lowest + 2) * s + tolerance));
+        window &= band;
+        if (window.empty()) continue;
+
+        // A blur of the window view reads its border pixels from the whole frame: identical to the full blur
+        Mat windowGray = gray(window);
+        GaussianBlur(raw(window), windowGray, Size(5, 5), 2);
+        fusedPickMask(gray, brightness, threshold, baselineCutoff, binary, windowTops, window);
+
+        // A steep flank can put the full-resolution top of a column below the window: such a column keeps
+        // the upsampled coarse top instead of losing its pick
+        for (int x = window.x; x < window.x + window.width; ++x) {
+            int top = windowTops[x];
+            const unsigned short coarseTop = levelTops[min(x / s, level.cols - 1)];
+            if (top == AzimuthEnvelope::kEmpty && coarseTop != AzimuthEnvelope::kEmpty) {
+                const int row = max(coarseTop * s, band.y);
+                if (row < band.y + band.height) top = row;
+            }
+            if (top < tops[x]) tops[x] = static_cast<unsigned short>(top);
+        }
+    }
+}
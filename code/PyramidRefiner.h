@@ -0,0 +1,58 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- COARSE-TO-FINE (PYRAMID) PROCESSING ------- //
+// On high-resolution footage (4K) the baseline scan band, the blur and the pick mask dominate the per-frame
+// cost. In pyramid mode the raw gray frame is reduced with pyrDown by 2^levels, and the baseline candidate
+// and the pick mask are computed on that level. Only narrow bands then go back to full resolution:
+//  - the baseline rows within one coarse row (+ tolerance) of the coarse candidate, scanned with the normal
+//    row energy, so the detected row is the full-resolution one whenever the coarse maximum is the same edge,
+//  - tiles of kTileColumns coarse columns around the coarse pick tops: the rows from tolerance above the
+//    highest top to tolerance below the lowest one of the tile and its neighbours are blurred and masked at
+//    full resolution, and only these windows set the tops. A column whose full-resolution top lies below
+//    its window (a steep flank) keeps the upsampled coarse top.
+// The binary is the nearest-upsampled coarse mask with the windows at full resolution, enough for the
+// display contours and the convergence profile. The blurred full-resolution gray is only written inside
+// the windows, so the gray frame cache keeps the blurred pyramid level instead.
+
+struct PyramidConfig {
+    int levels = 0;                   // --pyramid N : pyramid level the search runs on (each halves the size, 0 = off)
+    int tolerance = 2;                // --pyramid-tolerance N : full-resolution rows searched beyond the coarse estimate
+};
+
+// Per-packet working set of the coarse-to-fine kernels (buffers are reused across frames)
+class PyramidRefiner {
+public:
+    static const int kMaxLevels = 3;  // 8x: finer picks vanish on the level
+    static const int kTileColumns = 8;
+
+    // Mirrors detectBaselineRow(frame, gray, detect, roi): converts the region to raw gray, reduces it to the
+    // pyramid level, blurs the level and returns the full-resolution baseline candidate (or -1)
+    int detectBaselineRow(const cv::Mat& frame, bool detect, const cv::Rect& roi, const PyramidConfig& config);
+
+    // Mirrors fusedPickMask(..., roi) on the frame of the last detectBaselineRow: binary and the refinement
+    // windows of gray are written inside the region, tops lowered to the full-resolution first foreground rows.
+    // May be called again with other trackbar values as long as the frame is unchanged.
+    void pickMask(int brightness, int threshold, int baselineCutoff, cv::Mat& gray, cv::Mat& binary,
+                  std::vector<unsigned short>& tops);
+
+    // Blurred pyramid level of the frame (zero-based coarse coordinates, valid inside the region)
+    const cv::Mat& coarseGray() const { return levelGray; }
+    // Downsampling factor of the level (1 while pyramid mode is off)
+    int scale() const { return factor; }
+
+private:
+    int factor = 1;
+    int tolerance = 0;
+    cv::Rect region;                  // Processed region, aligned to the level grid
+    cv::Rect coarseRegion;            // The same on the level
+    cv::Mat raw;                      // Unblurred full-resolution gray (the frame itself, or rawBuffer)
+    cv::Mat rawBuffer;                // Converted region of a BGR frame (full size, so neighbours are real pixels)
+    std::vector<cv::Mat> levels;      // Intermediate pyrDown results of the region
+    cv::Mat level;                    // Unblurred pyramid level (frame size / factor)
+    cv::Mat levelGray;                // Blurred level
+    cv::Mat levelBinary;
+    std::vector<unsigned short> levelTops;
+    std::vector<unsigned short> windowTops;  // Full-resolution tops found inside the windows
+};
@@ -0,0 +1,122 @@
+#include "SpatialIndex.h"
+#include <algorithm>           // for sort, lower_bound
+#include <climits>
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// Floor division that also rounds negative values down
+int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+} // namespace
+
+XSortedIndex::XSortedIndex(const vector<Point>& points) {
+    order.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) order[i] = static_cast<int>(i);
+
+    // Stable by index, so already x-sorted input (the usual case for outline corners) stays as it is
+    stable_sort(order.begin(), order.end(), [&points](int a, int b) { return points[a].x < points[b].x; });
+
+    xs.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) xs[i] = points[order[i]].x;
+}
+
+void XSortedIndex::window(int centerX, int radius, int after, vector<int>& indices) const {
+    indices.clear();
+    auto first = lower_bound(xs.begin(), xs.end(), centerX - radius);
+    for (auto it = first; it != xs.end() && *it <= centerX + radius; ++it) {
+        int index = order[it - xs.begin()];
+        if (index > after) indices.push_back(index);
+    }
+    sort(indices.begin(), indices.end());
+}
+
+GridIndex::GridIndex(const vector<Point>& points, int cellSize)
+    : points(points), cellSize(max(1, cellSize)) {
+    if (points.empty()) return;
+
+    Point minPt(INT_MAX, INT_MAX), maxPt(INT_MIN, INT_MIN);
+    for (const Point& pt : points) {
+        minPt.x = min(minPt.x, pt.x);
+        minPt.y = min(minPt.y, pt.y);
+        maxPt.x = max(maxPt.x, pt.x);
+        maxPt.y = max(maxPt.y, pt.y);
+    }
+    origin = minPt;
+    gridCols = (maxPt.x - minPt.x) / this->cellSize + 1;
+    gridRows = (maxPt.y - minPt.y) / this->cellSize + 1;
+
+    // Counting sort of the point indices into their cells (ascending index within a cell)
+    vector<int> cellOf(points.size());
+    cellStart.assign(static_cast<size_t>(gridCols) * gridRows + 1, 0);
+    for (size_t i = 0; i < points.size(); ++i) {
+        int cx = (points[i].x - origin.x) / this->cellSize;
+        int cy = (points[i].y - origin.y) / this->cellSize;
+        cellOf[i] = cy * gridCols + cx;
+        ++cellStart[cellOf[i] + 1];
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+
+    cellItems.resize(points.size());
+    vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < points.size(); ++i) {
+        cellItems[fill[cellOf[i]]++] = static_cast<int>(i);
+    }
+}
+
+int GridIndex::nearest(Point query, double maxDist, const vector<bool>& excluded) const {
+    if (points.empty() || maxDist <= 0) return -1;
+
+    // Cells that can hold a point within maxDist of the query
+    int reach = static_cast<int>(std::ceil(maxDist));
+    int cx0 = max(0, floorDiv(query.x - reach - origin.x, cellSize));
+    int cx1 = min(gridCols - 1, floorDiv(query.x + reach - origin.x, cellSize));
+    int cy0 = max(0, floorDiv(query.y - reach - origin.y, cellSize));
+    int cy1 = min(gridRows - 1, floorDiv(query.y + reach - origin.y, cellSize));
+
+    double bestDist = maxDist;
+    int bestIndex = -1;
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            int cell = cy * gridCols + cx;
+            for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                int index = cellItems[k];
+                if (excluded[index]) continue;  // Skip already matched
+
+                double dist = norm(query - points[index]);
+                if (dist < bestDist || (dist == bestDist && bestIndex != -1 && index < bestIndex)) {
+                    bestDist = dist;
+                    bestIndex = index;
+                }
+            }
+        }
+    }
+    return bestIndex;
+}
+
+vector<Point> blockMinY(const vector<vector<Point>>& contours, int scale, int blockWidth, int width) {
+    int blockCount = (width + blockWidth - 1) / blockWidth;
+    vector<Point> best(blockCount, Point(-1, INT_MAX));  // INT_MAX = very large value
+
+    for (const auto& contour : contours) {
+        for (const auto& pt : contour) {
+            Point scaled = pt * scale;  // Scale to zoomed frame
+            if (scaled.x < 0 || scaled.x >= width) continue;
+            Point& current = best[scaled.x / blockWidth];
+            if (scaled.y < current.y) {
+                current = scaled;
+            }
+        }
+    }
+
+    vector<Point> tips;
+    for (const Point& pt : best) {
+        if (pt.y != INT_MAX) tips.push_back(pt);
+    }
+    return tips;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <vector>
+
+// ------- SPATIAL INDEX ------- //
+// Small lookup structures for the click analysis, which used to compare every point with every other
+// point: red dot neighborhood filter, pick tip search per horizontal block and tip-to-red-dot matching.
+// All queries return exactly what the brute-force loops returned, including their tie-breaking (lowest
+// index wins), only without visiting points that cannot qualify.
+
+// Points sorted by x for horizontal window queries
+class XSortedIndex {
+public:
+    explicit XSortedIndex(const std::vector<cv::Point>& points);
+
+    // Indices of the points with |x - centerX| <= radius and index > after, in ascending index order
+    void window(int centerX, int radius, int after, std::vector<int>& indices) const;
+
+private:
+    std::vector<int> order;   // Point indices sorted by (x, index)
+    std::vector<int> xs;      // x of order[i]
+};
+
+// Uniform grid of square buckets for nearest neighbour lookups within a maximum distance
+class GridIndex {
+public:
+    GridIndex(const std::vector<cv::Point>& points, int cellSize);
+
+    // Index of the point closest to query with distance < maxDist that is not marked in excluded
+    // (lowest index on equal distance), -1 if there is none
+    int nearest(cv::Point query, double maxDist, const std::vector<bool>& excluded) const;
+
+private:
+    std::vector<cv::Point> points;
+    int cellSize = 1;
+    cv::Point origin;               // Top left corner of cell (0, 0)
+    int gridCols = 0, gridRows = 0;
+    std::vector<int> cellStart;     // Bucket of cell c is cellItems[cellStart[c] .. cellStart[c + 1])
+    std::vector<int> cellItems;     // Point indices, ascending within each bucket
+};
+
+// Highest point (smallest y, first one on ties) of the scaled contours in every blockWidth wide column
+// block of [0, width), in one pass over the points. Blocks without points are skipped.
+std::vector<cv::Point> blockMinY(const std::vector<std::vector<cv::Point>>& contours, int scale, int blockWidth, int width);
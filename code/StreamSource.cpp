@@ -0,0 +1,502 @@
+#include "StreamSource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const char kRingMagic[8] = { 'C', 'W', 'R', 'I', 'N', 'G', '1', 0 };
+const uint32_t kMaxFrameSide = 16384;        // Larger sizes are a corrupt header, not a camera
+const int kRingWaitMs = 5000;                // How long a reader started first waits for the producer's ring
+const int kReaderStallMs = 10000;            // A full ring the attached reader releases nothing of for this long: reader gone
+const int kReaderAttachMs = 30000;           // A full ring no reader attached to for this long: none is coming
+
+static_assert(sizeof(StreamFrameHeader) == 32, "the frame header is part of the stream protocol");
+static_assert(sizeof(StreamRingHeader) <= kStreamRingHeaderBytes, "the ring header must fit before slot 0");
+
+bool isShmName(const string& source) {
+    return source.compare(0, 4, "shm:") == 0;
+}
+
+#ifdef _WIN32
+bool isPipePath(const string& path) {
+    return path.compare(0, 9, "\\\\.\\pipe\\") == 0;
+}
+#endif
+
+// Waits for the other process: yield first, then sleep
+void idle(int& rounds) {
+    if (++rounds < 128) this_thread::yield();
+    else this_thread::sleep_for(chrono::microseconds(200));
+}
+
+} // namespace
+
+// ------- READER ------- //
+
+StreamSource::StreamSource(const StreamConfig& streamConfig) : config(streamConfig) {
+    const string& source = config.source;
+
+    if (isShmName(source)) {
+        // The producer creates the ring at its first frame: give it a moment if it was started together
+        string name = source.substr(4);
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(kRingWaitMs);
+        while (!mapRing(name) && chrono::steady_clock::now() < deadline) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        if (!ring) {
+            fail("no shared-memory frame ring named " + name + " (start the producer first)");
+            return;
+        }
+
+        // Frames older than the released cursor are gone; the producer waits on the ones after it
+        nextFrame = ring->released.load(memory_order_acquire);
+        ring->reader.store(kRingReaderAttached, memory_order_release);
+        inFlight.resize(ring->slotCount);
+        done.assign(ring->slotCount, 0);
+        opened = true;
+        return;
+    }
+
+#ifdef _WIN32
+    if (source == "-") {
+        handle = GetStdHandle(STD_INPUT_HANDLE);
+    }
+    else if (isPipePath(source)) {
+        // The analyzer is the pipe server: the producer connects as a client
+        HANDLE pipe = CreateNamedPipeA(source.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_WAIT, 1, 0, 1 << 20, 0, nullptr);
+        if (pipe != INVALID_HANDLE_VALUE && !ConnectNamedPipe(pipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED) {
+            CloseHandle(pipe);
+            pipe = INVALID_HANDLE_VALUE;
+        }
+        if (pipe != INVALID_HANDLE_VALUE) handle = pipe;
+        ownsHandle = true;
+    }
+    else {
+        HANDLE file = CreateFileA(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file != INVALID_HANDLE_VALUE) handle = file;
+        ownsHandle = true;
+    }
+    if (!handle || handle == INVALID_HANDLE_VALUE) {
+        handle = nullptr;
+        fail("cannot open " + source);
+        return;
+    }
+#else
+    // A FIFO blocks here until the producer opens it for writing
+    fd = source == "-" ? STDIN_FILENO : ::open(source.c_str(), O_RDONLY);
+    ownsHandle = source != "-";
+    if (fd < 0) {
+        fail("cannot open " + source);
+        return;
+    }
+#endif
+    opened = true;
+}
+
+bool StreamSource::mapRing(const string& name) {
+#ifdef _WIN32
+    HANDLE mappingHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!mappingHandle) return false;
+    void* mapped = MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!mapped || !VirtualQuery(mapped, &info, sizeof(info))) {
+        if (mapped) UnmapViewOfFile(mapped);
+        CloseHandle(mappingHandle);
+        return false;
+    }
+    size_t bytes = info.RegionSize;
+#else
+    int shmFd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+    if (shmFd < 0) return false;
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(shmFd, &info) == 0 && info.st_size > 0) {
+        mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    }
+    ::close(shmFd);
+    if (mapped == MAP_FAILED) return false;
+    size_t bytes = static_cast<size_t>(info.st_size);
+#endif
+
+    // The magic is written last, so a ring the producer is still setting up is not accepted yet
+    const StreamRingHeader* header = static_cast<const StreamRingHeader*>(mapped);
+    bool valid = bytes >= kStreamRingHeaderBytes && memcmp(header->magic, kRingMagic, sizeof(kRingMagic)) == 0 &&
+                 header->slotCount > 0 && header->slotBytes > sizeof(StreamFrameHeader) &&
+                 (bytes - kStreamRingHeaderBytes) / header->slotBytes >= header->slotCount;
+    if (!valid) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapped);
+        CloseHandle(mappingHandle);
+#else
+        munmap(mapped, bytes);
+#endif
+        return false;
+    }
+#ifdef _WIN32
+    mapping = mappingHandle;
+#endif
+    view = static_cast<char*>(mapped);
+    viewBytes = bytes;
+    ring = reinterpret_cast<StreamRingHeader*>(view);
+    return true;
+}
+
+StreamSource::~StreamSource() {
+    if (ring) ring->reader.store(kRingReaderGone, memory_order_release);   // A waiting producer stops
+#ifdef _WIN32
+    if (ownsHandle && handle) CloseHandle(static_cast<HANDLE>(handle));
+    if (view) UnmapViewOfFile(view);
+    if (mapping) CloseHandle(static_cast<HANDLE>(mapping));
+#else
+    if (ownsHandle && fd >= 0) ::close(fd);
+    if (view) munmap(view, viewBytes);
+#endif
+}
+
+string StreamSource::baseName(const string& source) {
+    if (source == "-") return "stdin";
+    if (isShmName(source)) return source.substr(4);
+    size_t lastSlash = source.find_last_of("/\\");
+    string fileOnly = source.substr(lastSlash + 1);
+    return fileOnly.substr(0, fileOnly.find_last_of('.'));
+}
+
+bool StreamSource::fail(const string& message) {
+    if (!interrupted) lastError = message;   // Stopping the pipeline is not an error
+    return false;
+}
+
+bool StreamSource::validHeader(const StreamFrameHeader& header, size_t available) {
+    bool valid = header.magic == kStreamFrameMagic && (header.channels == 1 || header.channels == 3) &&
+                 header.width > 0 && header.width <= kMaxFrameSide && header.height > 0 && header.height <= kMaxFrameSide &&
+                 header.stride >= header.width * header.channels &&
+                 static_cast<size_t>(header.stride) * header.height <= available;
+    return valid || fail("invalid frame header after " + to_string(frames) + " frames");
+}
+
+size_t StreamSource::readBytes(void* target, size_t bytes) {
+    char* out = static_cast<char*>(target);
+    size_t total = 0;
+    while (total < bytes && !interrupted) {
+#ifdef _WIN32
+        // Poll pipes so an interrupt is noticed; PeekNamedPipe fails on files and at the end of the pipe,
+        // where ReadFile reports the outcome
+        HANDLE h = static_cast<HANDLE>(handle);
+        DWORD available = 0;
+        if (PeekNamedPipe(h, nullptr, 0, nullptr, &available, nullptr) && available == 0) {
+            Sleep(1);
+            continue;
+        }
+        DWORD got = 0;
+        DWORD chunk = static_cast<DWORD>(min<size_t>(bytes - total, 1 << 24));
+        if (!ReadFile(h, out + total, chunk, &got, nullptr) || got == 0) break;
+#else
+        pollfd request = { fd, POLLIN, 0 };
+        int ready = poll(&request, 1, 100);   // Wake up now and then to notice an interrupt
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+        ssize_t got = ::read(fd, out + total, bytes - total);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+#endif
+        total += static_cast<size_t>(got);
+    }
+    return total;
+}
+
+bool StreamSource::readHeader(StreamFrameHeader& header) {
+    // Headerless frames (ffmpeg -f rawvideo): the size comes from the command line
+    if (config.rawSize.area() > 0) {
+        header.magic = kStreamFrameMagic;
+        header.width = static_cast<uint32_t>(config.rawSize.width);
+        header.height = static_cast<uint32_t>(config.rawSize.height);
+        header.channels = config.rawFormat == StreamPixelFormat::Gray ? 1 : 3;
+        header.stride = header.width * header.channels;
+        header.timestampUs = static_cast<int64_t>(frames * 1e6 / max(config.rawFps, 1e-3));
+        return true;
+    }
+
+    size_t got = readBytes(&header, sizeof(header));
+    if (got == 0) return false;   // Clean end of the stream
+    if (got < sizeof(header)) return fail("truncated frame header after " + to_string(frames) + " frames");
+    return validHeader(header, SIZE_MAX);
+}
+
+bool StreamSource::read(Mat& frame, double& timestampMs) {
+    if (!opened) return false;
+
+    if (ring) {
+        if (!waitPublished()) return false;
+        char* slot = view + kStreamRingHeaderBytes + static_cast<size_t>(nextFrame % ring->slotCount) * ring->slotBytes;
+        StreamFrameHeader header;
+        memcpy(&header, slot, sizeof(header));
+        if (!validHeader(header, ring->slotBytes - sizeof(header))) return false;
+
+        // Zero copy: the packet's frame is a header over the slot until the consumer returns it
+        frame = Mat(static_cast<int>(header.height), static_cast<int>(header.width), CV_8UC(static_cast<int>(header.channels)),
+                    slot + sizeof(header), header.stride);
+        timestampMs = header.timestampUs / 1000.0;
+
+        lock_guard<std::mutex> lock(releaseMutex);
+        inFlight[(inFlightHead + inFlightCount) % inFlight.size()] = nextFrame;
+        ++inFlightCount;
+        ++nextFrame;
+        ++frames;
+        return true;
+    }
+
+    StreamFrameHeader header;
+    if (!readHeader(header)) return false;
+    int rows = static_cast<int>(header.height);
+    int cols = static_cast<int>(header.width);
+    int channels = static_cast<int>(header.channels);
+    size_t bytes = static_cast<size_t>(header.stride) * header.height;
+
+    // The rows go straight into the packet's buffer; it is only (re)allocated when the geometry changes.
+    // Padded rows (stride > width * channels) are kept as a column range of a wider byte image.
+    bool reusable = frame.u && frame.data == frame.datastart && frame.rows == rows && frame.cols == cols &&
+                    frame.channels() == channels && frame.depth() == CV_8U && frame.step[0] == header.stride;
+    if (!reusable) {
+        Mat padded(rows, static_cast<int>(header.stride), CV_8UC1);
+        frame = padded.colRange(0, cols * channels).reshape(channels);
+    }
+    size_t got = readBytes(frame.data, bytes);
+    if (got < bytes) {
+        return got == 0 && config.rawSize.area() > 0 ? false
+                                                     : fail("truncated frame after " + to_string(frames) + " frames");
+    }
+
+    timestampMs = header.timestampUs / 1000.0;
+    ++frames;
+    return true;
+}
+
+bool StreamSource::skip() {
+    if (!ring) return FrameSource::skip();   // The bytes have to be read anyway
+    if (!opened || !waitPublished()) return false;
+
+    // Never referenced: the slot is free as soon as the frames before it are
+    lock_guard<std::mutex> lock(releaseMutex);
+    markDone(nextFrame);
+    ++nextFrame;
+    ++frames;
+    return true;
+}
+
+void StreamSource::returnFrame() {
+    if (!ring) return;
+    lock_guard<std::mutex> lock(releaseMutex);
+    if (inFlightCount == 0) return;
+    uint64_t frame = inFlight[inFlightHead];
+    inFlightHead = (inFlightHead + 1) % inFlight.size();
+    --inFlightCount;
+    markDone(frame);
+}
+
+void StreamSource::markDone(uint64_t frame) {
+    // The producer only reuses slots in frame order: advance the released cursor over every finished
+    // frame up to the oldest one a packet still holds
+    done[frame % done.size()] = 1;
+    uint64_t released = ring->released.load(memory_order_relaxed);
+    while (done[released % done.size()]) {
+        done[released % done.size()] = 0;
+        ++released;
+    }
+    ring->released.store(released, memory_order_release);
+}
+
+bool StreamSource::waitPublished() {
+    int rounds = 0;
+    while (ring->published.load(memory_order_acquire) <= nextFrame) {
+        // closed is set after the last frame was published
+        if (ring->closed.load(memory_order_acquire) && ring->published.load(memory_order_acquire) <= nextFrame) return false;
+        if (interrupted) return false;
+        idle(rounds);
+    }
+    return true;
+}
+
+// ------- WRITER ------- //
+
+StreamWriter::~StreamWriter() {
+    close();
+}
+
+bool StreamWriter::open(const string& target, int slotCount) {
+    close();
+    shmName.clear();
+    if (isShmName(target)) {
+        shmName = target.substr(4);
+        slots = max(1, slotCount);
+        return true;   // Created at the first frame, when the slot size is known
+    }
+
+#ifdef _WIN32
+    if (target == "-") {
+        handle = GetStdHandle(STD_OUTPUT_HANDLE);
+    }
+    else {
+        // A named pipe is created by the analyzer; connect to it as a client
+        HANDLE file = CreateFileA(target.c_str(), GENERIC_WRITE, 0, nullptr, isPipePath(target) ? OPEN_EXISTING : CREATE_ALWAYS,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        handle = file == INVALID_HANDLE_VALUE ? nullptr : file;
+        ownsHandle = true;
+    }
+    return handle != nullptr && handle != INVALID_HANDLE_VALUE;
+#else
+    fd = target == "-" ? STDOUT_FILENO : ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ownsHandle = target != "-";
+    return fd >= 0;
+#endif
+}
+
+bool StreamWriter::createRing(size_t slotBytes) {
+    viewBytes = kStreamRingHeaderBytes + slotBytes * static_cast<size_t>(slots);
+#ifdef _WIN32
+    HANDLE mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                              static_cast<DWORD>(static_cast<uint64_t>(viewBytes) >> 32),
+                                              static_cast<DWORD>(viewBytes & 0xFFFFFFFFu), shmName.c_str());
+    if (!mappingHandle) return false;
+    void* mapped = MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, viewBytes);
+    if (!mapped) {
+        CloseHandle(mappingHandle);
+        return false;
+    }
+    mapping = mappingHandle;
+#else
+    string name = "/" + shmName;
+    shm_unlink(name.c_str());   // Left behind by a producer that did not close
+    int shmFd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shmFd < 0) return false;
+    void* mapped = MAP_FAILED;
+    if (ftruncate(shmFd, static_cast<off_t>(viewBytes)) == 0) {
+        mapped = mmap(nullptr, viewBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    }
+    ::close(shmFd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+    view = static_cast<char*>(mapped);
+    ring = new (view) StreamRingHeader();
+    ring->slotCount = static_cast<uint32_t>(slots);
+    ring->slotBytes = static_cast<uint32_t>(slotBytes);
+    atomic_thread_fence(memory_order_release);
+    memcpy(ring->magic, kRingMagic, sizeof(kRingMagic));   // Last: a reader only accepts a complete header
+    return true;
+}
+
+bool StreamWriter::write(const Mat& frame, double timestampMs) {
+    if (frame.depth() != CV_8U || (frame.channels() != 1 && frame.channels() != 3)) return false;
+
+    StreamFrameHeader header;
+    header.magic = kStreamFrameMagic;
+    header.width = static_cast<uint32_t>(frame.cols);
+    header.height = static_cast<uint32_t>(frame.rows);
+    header.channels = static_cast<uint32_t>(frame.channels());
+    header.stride = header.width * header.channels;
+    header.reserved = 0;
+    header.timestampUs = static_cast<int64_t>(timestampMs * 1000.0);
+    size_t rowBytes = header.stride;
+
+    if (!shmName.empty()) {
+        size_t slotBytes = sizeof(header) + rowBytes * frame.rows;
+        if (!ring && !createRing(slotBytes)) return false;
+        if (slotBytes > ring->slotBytes) return false;
+
+        // Backpressure: the slot of frame written - slotCount must have been released, unless the reader
+        // left, stalls or never attaches
+        int rounds = 0;
+        uint64_t released = ring->released.load(memory_order_acquire);
+        auto progress = chrono::steady_clock::now();
+        while (written - released >= ring->slotCount) {
+            uint32_t reader = ring->reader.load(memory_order_acquire);
+            if (reader == kRingReaderGone) return false;
+            idle(rounds);
+
+            uint64_t now = ring->released.load(memory_order_acquire);
+            if (now != released) {
+                released = now;
+                progress = chrono::steady_clock::now();
+                continue;
+            }
+            int limitMs = reader == kRingReaderAttached ? kReaderStallMs : kReaderAttachMs;
+            if (chrono::steady_clock::now() - progress > chrono::milliseconds(limitMs)) return false;
+        }
+
+        char* slot = view + kStreamRingHeaderBytes + static_cast<size_t>(written % ring->slotCount) * ring->slotBytes;
+        memcpy(slot, &header, sizeof(header));
+        for (int y = 0; y < frame.rows; ++y) memcpy(slot + sizeof(header) + y * rowBytes, frame.ptr(y), rowBytes);
+        ring->published.store(++written, memory_order_release);
+        return true;
+    }
+
+    auto writeBytes = [&](const void* data, size_t bytes) {
+        const char* in = static_cast<const char*>(data);
+        while (bytes > 0) {
+#ifdef _WIN32
+            DWORD put = 0;
+            if (!WriteFile(static_cast<HANDLE>(handle), in, static_cast<DWORD>(min<size_t>(bytes, 1 << 24)), &put, nullptr) || put == 0) return false;
+#else
+            ssize_t put = ::write(fd, in, bytes);
+            if (put < 0 && errno == EINTR) continue;
+            if (put <= 0) return false;
+#endif
+            in += put;
+            bytes -= static_cast<size_t>(put);
+        }
+        return true;
+    };
+
+    if (!writeBytes(&header, sizeof(header))) return false;
+    if (frame.isContinuous()) return writeBytes(frame.data, rowBytes * frame.rows);
+    for (int y = 0; y < frame.rows; ++y) {
+        if (!writeBytes(frame.ptr(y), rowBytes)) return false;
+    }
+    return true;
+}
+
+void StreamWriter::close() {
+    if (ring) ring->closed.store(1, memory_order_release);
+#ifdef _WIN32
+    if (ownsHandle && handle) CloseHandle(static_cast<HANDLE>(handle));
+    if (view) UnmapViewOfFile(view);
+    if (mapping) CloseHandle(static_cast<HANDLE>(mapping));
+#else
+    if (ownsHandle && fd >= 0) ::close(fd);
+    if (view) munmap(view, viewBytes);
+    // A reader that has mapped the ring keeps reading the rest of it
+    if (ring) shm_unlink(("/" + shmName).c_str());
+#endif
+    handle = nullptr;
+    fd = -1;
+    ownsHandle = false;
+    mapping = nullptr;
+    view = nullptr;
+    ring = nullptr;
+    viewBytes = 0;
+    written = 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FrameSource.h"
+
+// ------- RAW FRAME STREAM ------- //
+// Frames of a capture process on the same machine, without a container to decode:
+//
+//   "-"            stdin             ffmpeg ... -f rawvideo -pix_fmt bgr24 - | code --stream - --stream-size 1920x1080
+//   <path>         named pipe / file (a FIFO on Linux, \\.\pipe\<name> on Windows)
+//   "shm:<name>"   shared-memory ring created by the producer (frame_stream_producer --shm <name>)
+//
+// On stdin and pipes every frame is a StreamFrameHeader followed by height rows of stride bytes, or,
+// with a fixed --stream-size, just the pixel rows (ffmpeg -f rawvideo). The rows are read straight into
+// the packet's frame buffer. In the shared-memory ring every slot holds one header + frame, and the
+// packet's frame is only a Mat header over the slot; the slot goes back to the producer when the
+// consumer returns the packet.
+//
+// Backpressure: a pipe fills up and blocks the producer while the pipeline waits for a free packet; the
+// ring producer waits until the analyzer has released the slot it is about to overwrite. With the
+// DropNewest policy frames are skipped instead, so the producer never waits.
+
+const std::uint32_t kStreamFrameMagic = 0x52465743;  // "CWFR"
+
+// Header in front of every frame (little endian, 32 bytes)
+struct StreamFrameHeader {
+    std::uint32_t magic;              // kStreamFrameMagic
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t channels;           // 1 = gray, 3 = BGR
+    std::uint32_t stride;             // Bytes per row, >= width * channels
+    std::uint32_t reserved;
+    std::int64_t timestampUs;         // Capture time in microseconds
+};
+
+// Start of the shared-memory ring; slot n % slotCount starts at kStreamRingHeaderBytes + n * slotBytes
+struct StreamRingHeader {
+    char magic[8];                    // "CWRING1"
+    std::uint32_t slotCount;
+    std::uint32_t slotBytes;          // StreamFrameHeader + pixel rows
+    std::atomic<std::uint64_t> published;  // Frames written by the producer (frame n is in slot n % slotCount)
+    std::atomic<std::uint64_t> released;   // Frames the analyzer is done with; slots of frames < released may be overwritten
+    std::atomic<std::uint32_t> closed;     // Set by the producer after its last frame
+    std::atomic<std::uint32_t> reader;     // StreamRingReader: set by the analyzer when it attaches and leaves
+};
+const size_t kStreamRingHeaderBytes = 64;
+
+// StreamRingHeader::reader
+enum StreamRingReader : std::uint32_t { kRingReaderNone = 0, kRingReaderAttached = 1, kRingReaderGone = 2 };
+
+enum class StreamPixelFormat { Gray, Bgr };
+
+struct StreamConfig {
+    std::string source;               // --stream <source> : "-", a pipe path or "shm:<name>" (empty = off)
+    cv::Size rawSize;                 // --stream-size WxH : headerless frames of this size (0x0 = headers)
+    StreamPixelFormat rawFormat = StreamPixelFormat::Bgr; // --stream-format gray|bgr : headerless frames
+    double rawFps = 30.0;             // --stream-fps : timestamps of headerless frames
+};
+
+class StreamSource : public FrameSource {
+public:
+    explicit StreamSource(const StreamConfig& config);
+    ~StreamSource() override;
+
+    StreamSource(const StreamSource&) = delete;
+    StreamSource& operator=(const StreamSource&) = delete;
+
+    bool isOpen() const { return opened; }
+    // Why the stream could not be opened or ended early (empty = clean end of stream)
+    const std::string& error() const { return lastError; }
+    // Output base name of the stream ("stdin", the ring name or the pipe file name)
+    static std::string baseName(const std::string& source);
+
+    bool read(cv::Mat& frame, double& timestampMs) override;
+    bool skip() override;
+    void returnFrame() override;
+    void interrupt() override { interrupted = true; }
+
+private:
+    // Maps an existing, fully set up ring; false (nothing mapped) otherwise
+    bool mapRing(const std::string& name);
+    bool readHeader(StreamFrameHeader& header);
+    // Reads until bytes arrived, the stream ended or the read was interrupted; returns the bytes read
+    size_t readBytes(void* target, size_t bytes);
+    bool fail(const std::string& message);
+    bool validHeader(const StreamFrameHeader& header, size_t available);
+    // Ring: waits until frame nextFrame is published; false at the end or when interrupted
+    bool waitPublished();
+    void markDone(std::uint64_t frame);
+
+    StreamConfig config;
+    bool opened = false;
+    std::string lastError;
+    std::atomic<bool> interrupted{ false };
+    long long frames = 0;             // Frames read so far (timestamps of headerless frames)
+
+    // Pipe / stdin
+    void* handle = nullptr;           // Platform handle (Windows) of the pipe
+    int fd = -1;                      // File descriptor (POSIX) of the pipe
+    bool ownsHandle = false;          // false for stdin
+
+    // Shared-memory ring
+    void* mapping = nullptr;          // Platform handle of the mapping
+    char* view = nullptr;
+    size_t viewBytes = 0;
+    StreamRingHeader* ring = nullptr;
+    std::uint64_t nextFrame = 0;      // Next ring frame to read (decoder thread)
+    std::mutex releaseMutex;          // Guards the fields below (decoder and consumer thread)
+    std::vector<std::uint64_t> inFlight; // Ring frames held by packets, oldest first (circular)
+    size_t inFlightHead = 0;
+    size_t inFlightCount = 0;
+    std::vector<char> done;           // Per slot: frame finished, waiting for the older ones
+};
+
+// Producer side of the protocol (frame_stream_producer and capture processes linked against the core)
+class StreamWriter {
+public:
+    StreamWriter() = default;
+    ~StreamWriter();
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // target: "-" = stdout, "shm:<name>" = new ring of slotCount frames (created at the first frame, sized
+    // for it), else a file / named pipe
+    bool open(const std::string& target, int slotCount = 4);
+    // Writes an 8-bit gray or BGR frame with its header; waits while the ring is full. False if the
+    // reader has gone or the frame does not fit the ring. A full ring counts as a gone reader once the
+    // reader has left, released no frame for 10 s, or has not attached within 30 s.
+    bool write(const cv::Mat& frame, double timestampMs);
+    // Marks the ring closed / closes the pipe
+    void close();
+
+private:
+    bool createRing(size_t slotBytes);
+
+    std::string shmName;              // Ring name (empty = pipe)
+    int slots = 4;
+    void* handle = nullptr;
+    int fd = -1;
+    bool ownsHandle = false;
+    void* mapping = nullptr;
+    char* view = nullptr;
+    size_t viewBytes = 0;
+    StreamRingHeader* ring = nullptr;
+    std::uint64_t written = 0;
+};
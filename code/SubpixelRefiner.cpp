@@ -0,0 +1,104 @@
+#include "SubpixelRefiner.h"
+#include "BaselineDetector.h"
+#include "FrameProcessing.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// Bilinear gray value at a sub-pixel position (clamped to the frame)
+float sample(const Mat& gray, float x, float y) {
+    x = min(max(x, 0.f), static_cast<float>(gray.cols - 1));
+    y = min(max(y, 0.f), static_cast<float>(gray.rows - 1));
+    int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+    int x1 = min(x0 + 1, gray.cols - 1), y1 = min(y0 + 1, gray.rows - 1);
+    float fx = x - x0, fy = y - y0;
+
+    const uchar* r0 = gray.ptr<uchar>(y0);
+    const uchar* r1 = gray.ptr<uchar>(y1);
+    float top = r0[x0] + fx * (r0[x1] - r0[x0]);
+    float bottom = r1[x0] + fx * (r1[x1] - r1[x0]);
+    return top + fy * (bottom - top);
+}
+
+} // namespace
+
+float SubpixelRefiner::edgeOffset(const Mat& gray, Point2f point, Point2f normal, float radius) {
+    CV_Assert(gray.type() == CV_8UC1);
+    float length = std::sqrt(normal.dot(normal));
+    if (length == 0.f || gray.empty()) return 0.f;
+    normal = normal * (1.f / length);
+    Point2f tangent(-normal.y, normal.x);
+
+    // Profile along the normal in quarter-pixel steps
+    const float step = 0.25f;
+    const int samples = static_cast<int>(2 * radius / step) + 1;
+    vector<float> profile(samples);
+    for (int k = 0; k < samples; ++k) {
+        Point2f p = point + normal * (-radius + k * step);
+        float sum = 0.f;
+        for (int s = -1; s <= 1; ++s) {
+            Point2f q = p + tangent * static_cast<float>(s);
+            sum += sample(gray, q.x, q.y);
+        }
+        profile[k] = sum / 3.f;
+    }
+
+    // Central-difference gradient magnitude; only the upper half of the peak enters the centroid, so
+    // noise on the flat parts of the profile does not pull the edge away
+    vector<float> gradient(samples, 0.f);
+    float peak = 0.f;
+    for (int k = 1; k < samples - 1; ++k) {
+        gradient[k] = std::abs(profile[k + 1] - profile[k - 1]);
+        peak = max(peak, gradient[k]);
+    }
+    if (peak == 0.f) return 0.f;
+
+    float weightSum = 0.f, offsetSum = 0.f;
+    for (int k = 1; k < samples - 1; ++k) {
+        float w = gradient[k] - 0.5f * peak;
+        if (w <= 0.f) continue;
+        weightSum += w;
+        offsetSum += w * (-radius + k * step);
+    }
+    return weightSum > 0.f ? offsetSum / weightSum : 0.f;
+}
+
+Point2f SubpixelRefiner::refineTip(const Mat& gray, Point tip, float level, int halfWidth) {
+    // Height: the apex edge lies on the upward normal of the topmost foreground pixel
+    Point2f refined(static_cast<float>(tip.x), static_cast<float>(tip.y));
+    refined.y -= edgeOffset(gray, refined, Point2f(0.f, -1.f));
+
+    // Position: centre of the intensity above the mask level in the rows of the apex
+    float weightSum = 0.f, xSum = 0.f;
+    for (int y = max(0, tip.y); y <= min(gray.rows - 1, tip.y + 2); ++y) {
+        const uchar* row = gray.ptr<uchar>(y);
+        for (int x = max(0, tip.x - halfWidth); x <= min(gray.cols - 1, tip.x + halfWidth); ++x) {
+            float w = row[x] - level;
+            if (w <= 0.f) continue;
+            weightSum += w;
+            xSum += w * x;
+        }
+    }
+    if (weightSum > 0.f) refined.x = xSum / weightSum;
+    return refined;
+}
+
+float SubpixelRefiner::refineBaseline(const Mat& gray, float baselineY) {
+    if (baselineY == -1) return baselineY;
+    const float rowOffset = baselineFromRow(0);
+    int row = cvRound(baselineY - rowOffset);
+    if (row < 1 || row + 1 >= gray.rows) return baselineY;
+
+    // Parabola through the energy of the baseline row and its neighbours; its vertex is the edge
+    vector<float> energy;
+    BaselineDetector::rowEnergy(gray, row - 1, row + 2, energy);
+    float denominator = energy[0] - 2.f * energy[1] + energy[2];
+    if (denominator >= 0.f) return baselineY;   // Not a peak in this frame
+    float offset = 0.5f * (energy[0] - energy[2]) / denominator;
+    return row + min(max(offset, -0.5f), 0.5f) + rowOffset;
+}
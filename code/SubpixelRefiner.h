@@ -0,0 +1,27 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+
+// ------- SUB-PIXEL REFINEMENT ------- //
+// The contour and baseline detectors work on whole native pixels. The refiner moves their results to
+// sub-pixel positions using the gray frame itself, so the measurements gain precision without the
+// frame ever being upsampled (the 4x "zoomed" units are only a unit, not a resampled image):
+//  - an edge is located along its normal as the centroid of the intensity gradient over a short
+//    bilinearly sampled profile,
+//  - a pick tip is refined upwards on its apex and sideways by the intensity-weighted centre of the
+//    apex rows,
+//  - the baseline is refined by a parabola through the row gradient energy around its row.
+// All coordinates are native px.
+
+class SubpixelRefiner {
+public:
+    // Offset (px, along normal) of the strongest edge within +-radius of point. The profile is averaged
+    // over three parallel lines one pixel apart; 0 if there is no gradient at all.
+    static float edgeOffset(const cv::Mat& gray, cv::Point2f point, cv::Point2f normal, float radius = 3.f);
+
+    // Sub-pixel apex of a pick whose topmost foreground pixel is tip. level is the gray value the pick
+    // mask thresholds at (threshold - brightness).
+    static cv::Point2f refineTip(const cv::Mat& gray, cv::Point tip, float level, int halfWidth = 4);
+
+    // Sub-pixel baseline for a baseline value from baselineFromRow (the same fixed row offset is kept)
+    static float refineBaseline(const cv::Mat& gray, float baselineY);
+};
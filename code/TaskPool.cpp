@@ -0,0 +1,44 @@
+#include "TaskPool.h"
+#include <algorithm>
+
+using namespace std;           // Use the std namespace for standard library
+
+TaskPool::TaskPool(int threads) {
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&TaskPool::workerLoop, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t TaskPool::pending() const {
+    lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+void TaskPool::workerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;  // Stopping and nothing left to run
+
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
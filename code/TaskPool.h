@@ -0,0 +1,57 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ------- TASK POOL ------- //
+// Fixed set of worker threads running queued tasks in FIFO order. submit() returns a std::future, so
+// the caller (e.g. the GUI loop) can poll for the result without ever blocking on the work itself.
+class TaskPool {
+public:
+    // threads = 0 uses one thread per hardware core
+    explicit TaskPool(int threads = 0);
+    // Runs the tasks that are still queued, then joins the workers
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task) {
+        typedef typename std::result_of<F()>::type Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([packaged]() { (*packaged)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    // Tasks waiting for a free worker
+    size_t pending() const;
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// True once the future holds its result (never blocks)
+template <typename T>
+bool isReady(const std::future<T>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
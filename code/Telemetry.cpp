@@ -0,0 +1,227 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const int kStageCount = static_cast<int>(Stage::Count);
+const int kCounterCount = static_cast<int>(Counter::Count);
+
+// Raises target to at least value
+void atomicMax(atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, memory_order_relaxed)) {}
+}
+
+void atomicMax(atomic<long long>& target, long long value) {
+    long long current = target.load(memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, memory_order_relaxed)) {}
+}
+
+string formatMs(double ms) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", ms);
+    return text;
+}
+
+} // namespace
+
+const char* stageName(Stage stage) {
+    static const char* names[kStageCount] = {
+        "decode", "baseline", "mask", "contours", "wait", "merge", "display", "frame", "analysis", "render", "track"
+    };
+    return names[static_cast<int>(stage)];
+}
+
+const char* counterName(Counter counter) {
+    static const char* names[kCounterCount] = {
+        "frames_decoded", "frames_dropped", "display_skipped", "budget_overruns", "clicks_analyzed",
+        "analysis_skipped", "clock_resyncs"
+    };
+    return names[static_cast<int>(counter)];
+}
+
+// ------- LATENCY HISTOGRAM ------- //
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& bucket : buckets) bucket.store(0, memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < 4) return static_cast<int>(us);   // 0..3 us exact
+
+    int msb = 2;
+    while (msb < 63 && (us >> (msb + 1)) != 0) ++msb;
+    int bucket = 4 * (msb - 1) + static_cast<int>((us >> (msb - 2)) & 3);
+    return min(bucket, kBuckets - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperUs(int bucket) {
+    if (bucket < 4) return static_cast<uint64_t>(bucket);
+    int msb = bucket / 4 + 1;
+    uint64_t lower = static_cast<uint64_t>(4 + bucket % 4) << (msb - 2);
+    return lower + (1ULL << (msb - 2)) - 1;
+}
+
+void LatencyHistogram::record(chrono::steady_clock::duration elapsed) {
+    long long us = chrono::duration_cast<chrono::microseconds>(elapsed).count();
+    uint64_t value = static_cast<uint64_t>(max(0LL, us));
+
+    buckets[bucketOf(value)].fetch_add(1, memory_order_relaxed);
+    sumUs.fetch_add(value, memory_order_relaxed);
+    atomicMax(maxUs, value);
+}
+
+LatencyHistogram::Summary LatencyHistogram::drain() {
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] = buckets[i].exchange(0, memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t sum = sumUs.exchange(0, memory_order_relaxed);
+    uint64_t maximum = maxUs.exchange(0, memory_order_relaxed);
+
+    Summary summary;
+    summary.count = static_cast<long long>(total);
+    if (total == 0) return summary;
+
+    summary.meanMs = sum / 1000.0 / total;
+    summary.maxMs = maximum / 1000.0;
+
+    // Upper bound of the bucket holding the requested rank, capped by the exact maximum
+    auto percentile = [&](double p) {
+        uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(p * total + 0.999999));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return min(bucketUpperUs(i), maximum) / 1000.0;
+        }
+        return summary.maxMs;
+    };
+    summary.p50Ms = percentile(0.50);
+    summary.p90Ms = percentile(0.90);
+    summary.p99Ms = percentile(0.99);
+    return summary;
+}
+
+// ------- TELEMETRY ------- //
+
+Telemetry::Telemetry() : created(chrono::steady_clock::now()), lastTick(created) {
+    for (auto& counter : counters) counter.store(0, memory_order_relaxed);
+}
+
+void Telemetry::sampleQueueDepth(size_t depth) {
+    long long value = static_cast<long long>(depth);
+    queueDepthLast.store(value, memory_order_relaxed);
+    atomicMax(queueDepthMax, value);
+}
+
+void Telemetry::recordFrame(chrono::steady_clock::duration elapsed) {
+    record(Stage::Frame, elapsed);
+    if (chrono::duration<double, milli>(elapsed).count() > frameBudgetMs) {
+        count(Counter::BudgetOverruns);
+    }
+}
+
+bool Telemetry::openExport(const string& path) {
+    exportJson = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    exportFile.open(path);
+    if (!exportFile) return false;
+
+    if (!exportJson) {
+        exportFile << "time_s,metric,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,value,max_value\n";
+    }
+    return true;
+}
+
+bool Telemetry::tick(bool force) {
+    auto now = chrono::steady_clock::now();
+    double sinceLast = chrono::duration<double>(now - lastTick).count();
+    if (!force && sinceLast < intervalSec) return false;
+
+    TelemetrySnapshot next;
+    next.timeSec = chrono::duration<double>(now - created).count();
+    next.intervalSec = sinceLast;
+    for (int i = 0; i < kStageCount; ++i) next.stages[i] = histograms[i].drain();
+    for (int i = 0; i < kCounterCount; ++i) next.counters[i] = counters[i].exchange(0, memory_order_relaxed);
+    next.queueDepthLast = queueDepthLast.load(memory_order_relaxed);
+    next.queueDepthMax = queueDepthMax.exchange(next.queueDepthLast, memory_order_relaxed);
+
+    snapshot = next;
+    lastTick = now;
+
+    if (exportFile.is_open()) {
+        if (exportJson) writeJson(snapshot);
+        else writeCsv(snapshot);
+        exportFile.flush();   // The file is read while the player keeps running
+    }
+    return true;
+}
+
+void Telemetry::writeCsv(const TelemetrySnapshot& s) {
+    for (int i = 0; i < kStageCount; ++i) {
+        const auto& stage = s.stages[i];
+        if (stage.count == 0) continue;
+        exportFile << s.timeSec << "," << stageName(static_cast<Stage>(i)) << "," << stage.count << ","
+                   << stage.meanMs << "," << stage.p50Ms << "," << stage.p90Ms << "," << stage.p99Ms << ","
+                   << stage.maxMs << ",,\n";
+    }
+    for (int i = 0; i < kCounterCount; ++i) {
+        exportFile << s.timeSec << "," << counterName(static_cast<Counter>(i)) << ",,,,,,," << s.counters[i] << ",\n";
+    }
+    exportFile << s.timeSec << ",queue_depth,,,,,,," << s.queueDepthLast << "," << s.queueDepthMax << "\n";
+}
+
+void Telemetry::writeJson(const TelemetrySnapshot& s) {
+    // One JSON object per line
+    exportFile << "{\"time_s\":" << s.timeSec << ",\"interval_s\":" << s.intervalSec << ",\"stages\":{";
+    bool first = true;
+    for (int i = 0; i < kStageCount; ++i) {
+        const auto& stage = s.stages[i];
+        if (stage.count == 0) continue;
+        exportFile << (first ? "" : ",") << "\"" << stageName(static_cast<Stage>(i)) << "\":{\"count\":" << stage.count
+                   << ",\"mean_ms\":" << stage.meanMs << ",\"p50_ms\":" << stage.p50Ms << ",\"p90_ms\":" << stage.p90Ms
+                   << ",\"p99_ms\":" << stage.p99Ms << ",\"max_ms\":" << stage.maxMs << "}";
+        first = false;
+    }
+    exportFile << "},\"counters\":{";
+    for (int i = 0; i < kCounterCount; ++i) {
+        exportFile << (i ? "," : "") << "\"" << counterName(static_cast<Counter>(i)) << "\":" << s.counters[i];
+    }
+    exportFile << "},\"queue_depth\":{\"last\":" << s.queueDepthLast << ",\"max\":" << s.queueDepthMax << "}}\n";
+}
+
+void Telemetry::drawHud(Mat& frame) const {
+    const double fontScale = 0.5;
+    const int lineHeight = 18;
+    int y = lineHeight;
+
+    auto line = [&](const string& text, const Scalar& color) {
+        // Dark outline keeps the text readable on bright footage
+        putText(frame, text, Point(10, y), FONT_HERSHEY_SIMPLEX, fontScale, Scalar(0, 0, 0), 3);
+        putText(frame, text, Point(10, y), FONT_HERSHEY_SIMPLEX, fontScale, color, 1);
+        y += lineHeight;
+    };
+
+    line("stage      p50 / p99 ms  (budget " + formatMs(frameBudgetMs) + " ms)", Scalar(255, 255, 255));
+    for (int i = 0; i < kStageCount; ++i) {
+        const auto& stage = snapshot.stages[i];
+        if (stage.count == 0) continue;
+        string name = stageName(static_cast<Stage>(i));
+        name.resize(10, ' ');
+        bool overBudget = stage.p99Ms > frameBudgetMs;
+        line(name + " " + formatMs(stage.p50Ms) + " / " + formatMs(stage.p99Ms),
+             overBudget ? Scalar(0, 0, 255) : Scalar(0, 255, 0));
+    }
+
+    const long long* c = snapshot.counters;
+    line("dropped " + to_string(c[static_cast<int>(Counter::FramesDropped)])
+         + "  skipped " + to_string(c[static_cast<int>(Counter::DisplaySkipped)])
+         + "  overruns " + to_string(c[static_cast<int>(Counter::BudgetOverruns)])
+         + "  queue " + to_string(snapshot.queueDepthLast) + " (max " + to_string(snapshot.queueDepthMax) + ")",
+         Scalar(255, 255, 255));
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// ------- TELEMETRY ------- //
+// Per-stage latency histograms and frame counters for the player, the batch mode and the click analysis.
+// Recording is lock-free (relaxed atomic increments), so any pipeline thread can record on the hot path.
+// One owner thread (the GUI / batch loop) calls tick() once per frame: every interval it drains the
+// histograms into a snapshot, appends that snapshot to the export file and keeps it for the on-screen HUD.
+
+enum class Stage {
+    Decode,          // VideoCapture::read (decoder thread)
+    Baseline,        // Gray conversion + baseline detection + blur (workers)
+    Mask,            // Brightness + threshold + masking (workers)
+    Contours,        // Per-frame pick contours (workers)
+    Wait,            // Consumer blocked until the next frame was analyzed
+    Merge,           // Baseline merge + azimuth accumulation (consumer)
+    Display,         // Drawing + imshow + GUI events (consumer)
+    Frame,           // Whole consumer iteration, compared against the frame budget
+    Analysis,        // Click analysis (FrameAnalyzer::analyze)
+    Render,          // Annotation rendering + file output of a click
+    Track,           // Per-frame pick tracking (consumer, --track)
+    Count
+};
+
+enum class Counter {
+    FramesDecoded,
+    FramesDropped,      // Discarded by the decoder (DropNewest policy)
+    DisplaySkipped,     // Not shown because the player was behind (--late)
+    BudgetOverruns,     // Consumer iterations longer than the frame budget
+    ClicksAnalyzed,
+    AnalysisSkipped,    // Frames passed through without analysis (converged monitoring cadence)
+    ClockResyncs,       // Player clock re-anchored (looped video or lag beyond the limit)
+    Count
+};
+
+const char* stageName(Stage stage);
+const char* counterName(Counter counter);
+
+// Latency histogram with log-linear microsecond buckets (4 per power of two, <= 25% bucket error)
+class LatencyHistogram {
+public:
+    struct Summary {
+        long long count = 0;
+        double meanMs = 0, p50Ms = 0, p90Ms = 0, p99Ms = 0, maxMs = 0;
+    };
+
+    LatencyHistogram();
+
+    void record(std::chrono::steady_clock::duration elapsed);
+    // Summary of everything recorded since the last drain; resets the histogram (samples recorded while
+    // draining may end up in either interval)
+    Summary drain();
+
+private:
+    static const int kBuckets = 128;
+    static int bucketOf(uint64_t us);
+    static uint64_t bucketUpperUs(int bucket);
+
+    std::atomic<uint64_t> buckets[kBuckets];
+    std::atomic<uint64_t> sumUs{ 0 };
+    std::atomic<uint64_t> maxUs{ 0 };
+};
+
+struct TelemetrySnapshot {
+    double timeSec = 0;                                           // Since the telemetry was created
+    double intervalSec = 0;
+    LatencyHistogram::Summary stages[static_cast<int>(Stage::Count)];
+    long long counters[static_cast<int>(Counter::Count)] = {};    // Increments during the interval
+    long long queueDepthLast = 0, queueDepthMax = 0;              // Analyzed frames waiting for the consumer
+};
+
+class Telemetry {
+public:
+    Telemetry();
+
+    // ---- Any thread ----
+    void record(Stage stage, std::chrono::steady_clock::duration elapsed) { histograms[static_cast<int>(stage)].record(elapsed); }
+    void count(Counter counter, long long n = 1) { counters[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed); }
+    void sampleQueueDepth(size_t depth);
+
+    // ---- Owner thread ----
+    // One consumer iteration: recorded as Stage::Frame, counted as overrun if it exceeds the frame budget
+    void recordFrame(std::chrono::steady_clock::duration elapsed);
+    // Appends every snapshot to path: JSON lines for *.json, CSV otherwise. False if it cannot be opened.
+    bool openExport(const std::string& path);
+    void setInterval(double seconds) { intervalSec = seconds; }
+    void setFrameBudgetMs(double ms) { frameBudgetMs = ms; }
+
+    // Takes a snapshot once the interval has passed (force = now); true if a new snapshot was taken
+    bool tick(bool force = false);
+    const TelemetrySnapshot& last() const { return snapshot; }
+
+    // Latest snapshot as text lines in the top left corner of a display frame; stages whose p99 exceeds
+    // the frame budget are drawn in red
+    void drawHud(cv::Mat& frame) const;
+
+private:
+    void writeCsv(const TelemetrySnapshot& s);
+    void writeJson(const TelemetrySnapshot& s);
+
+    LatencyHistogram histograms[static_cast<int>(Stage::Count)];
+    std::atomic<long long> counters[static_cast<int>(Counter::Count)];
+    std::atomic<long long> queueDepthLast{ 0 };
+    std::atomic<long long> queueDepthMax{ 0 };
+
+    std::chrono::steady_clock::time_point created, lastTick;
+    double intervalSec = 2.0;
+    double frameBudgetMs = 33.3;
+    TelemetrySnapshot snapshot;
+    std::ofstream exportFile;
+    bool exportJson = false;
+};
+
+// Records the lifetime of the scope as one sample of a stage (no-op without telemetry)
+class ScopedTimer {
+public:
+    ScopedTimer(Telemetry* telemetry, Stage stage)
+        : telemetry(telemetry), stage(stage), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        if (telemetry) telemetry->record(stage, std::chrono::steady_clock::now() - start);
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Telemetry* telemetry;
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,70 @@
+#include "VideoChunks.h"
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+vector<long long> scanKeyframes(const string& videoPath, long long& frameCount) {
+    frameCount = 0;
+    vector<long long> keyframes;
+
+    // CAP_PROP_FORMAT -1 switches the FFmpeg backend to raw packets: grab() only demuxes
+    VideoCapture raw;
+    if (!raw.open(videoPath, CAP_FFMPEG) || !raw.set(CAP_PROP_FORMAT, -1)) return keyframes;
+
+    // Packets come in decode order; with B-frames, packet N is not display frame N. The packet timestamp
+    // gives the display index, as long as the backend reports a distinct one per packet
+    vector<double> keyframeMs;
+    unordered_set<long long> timestamps;
+    const double fps = raw.get(CAP_PROP_FPS);
+    for (long long index = 0; raw.grab(); ++index) {
+        const double ms = raw.get(CAP_PROP_POS_MSEC);
+        timestamps.insert(llround(ms * 1000));
+        if (raw.get(CAP_PROP_LRF_HAS_KEY_FRAME) != 0) {
+            keyframes.push_back(index);
+            keyframeMs.push_back(ms);
+        }
+        frameCount = index + 1;
+    }
+    if (fps <= 0 || static_cast<long long>(timestamps.size()) != frameCount) return keyframes;
+
+    const double firstMs = static_cast<double>(*min_element(timestamps.begin(), timestamps.end())) / 1000;
+    for (size_t k = 0; k < keyframes.size(); ++k) {
+        keyframes[k] = min(frameCount - 1, llround((keyframeMs[k] - firstMs) * fps / 1000));
+    }
+    sort(keyframes.begin(), keyframes.end());
+    keyframes.erase(unique(keyframes.begin(), keyframes.end()), keyframes.end());
+    return keyframes;
+}
+
+vector<FrameRange> planChunks(const string& videoPath, int chunks) {
+    long long frameCount = 0;
+    vector<long long> keyframes = scanKeyframes(videoPath, frameCount);
+    if (frameCount == 0) {
+        VideoCapture cap(videoPath);
+        frameCount = static_cast<long long>(cap.get(CAP_PROP_FRAME_COUNT));
+    }
+    if (chunks <= 1 || frameCount <= 1) return vector<FrameRange>(1);
+
+    vector<long long> starts(1, 0);
+    for (int k = 1; k < chunks; ++k) {
+        long long split = frameCount * k / chunks;
+        if (!keyframes.empty()) {
+            // Nearest keyframe to the even split point
+            auto next = lower_bound(keyframes.begin(), keyframes.end(), split);
+            if (next == keyframes.end() || (next != keyframes.begin() && split - *(next - 1) <= *next - split)) --next;
+            split = *next;
+        }
+        if (split > starts.back() && split < frameCount) starts.push_back(split);
+    }
+
+    vector<FrameRange> ranges(starts.size());
+    for (size_t i = 0; i < starts.size(); ++i) {
+        ranges[i].start = starts[i];
+        ranges[i].end = i + 1 < starts.size() ? starts[i + 1] : -1;
+    }
+    return ranges;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// ------- VIDEO CHUNKS ------- //
+// Split of one video into contiguous frame ranges for the chunked batch mode (one decoder per range).
+// Split points are moved to the nearest keyframe, so every decoder starts on a random access point and
+// no GOP is decoded twice. The ranges are defined by frame index, so the split never changes which
+// frames are processed; only where the decoders start.
+
+struct FrameRange {
+    long long start = 0;    // First frame
+    long long end = -1;     // One past the last frame (-1 = until the end of the video)
+};
+
+// Keyframe indices of the video from a demux-only pass (packets are read, not decoded); frameCount
+// receives the number of packets. The indices are display indices from the packet timestamps. If the
+// backend gives no distinct timestamp per packet they stay packet (decode order) indices, which are only
+// the display indices in streams without B-frames: the splits are then near the keyframes, not on them.
+// Empty if the backend cannot deliver raw packets.
+std::vector<long long> scanKeyframes(const std::string& videoPath, long long& frameCount);
+
+// Up to `chunks` contiguous ranges covering the whole video, in frame order. Falls back to evenly
+// spaced split points when no keyframe index is available and to one range when the length is unknown.
+std::vector<FrameRange> planChunks(const std::string& videoPath, int chunks);
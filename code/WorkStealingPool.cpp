@@ -0,0 +1,107 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+// Worker identity of the calling thread
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < threads; ++i) {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void WorkStealingPool::push(function<void()> task) {
+    int self = currentPool == this ? currentWorker : -1;
+    int target = self >= 0 ? self : static_cast<int>(nextQueue.fetch_add(1, memory_order_relaxed) % queues.size());
+    {
+        lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(move(task));
+    }
+    {
+        // Under the idle mutex, so a worker that just found nothing cannot miss the wake-up
+        lock_guard<std::mutex> lock(idleMutex);
+        queued.fetch_add(1, memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::take(int self, function<void()>& task) {
+    const int count = static_cast<int>(queues.size());
+
+    // Own deque first, newest task
+    if (self >= 0) {
+        WorkerQueue& own = *queues[self];
+        lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Steal the oldest task of another deque
+    int start = self >= 0 ? self + 1 : 0;
+    for (int i = 0; i < count; ++i) {
+        int victim = (start + i) % count;
+        if (victim == self) continue;
+
+        WorkerQueue& other = *queues[victim];
+        lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = move(other.tasks.front());
+            other.tasks.pop_front();
+            queued.fetch_sub(1, memory_order_relaxed);
+            if (self >= 0) stealCount.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::runOne() {
+    function<void()> task;
+    if (!take(currentPool == this ? currentWorker : -1, task)) return false;
+    task();
+    return true;
+}
+
+void WorkStealingPool::waitForWork(chrono::milliseconds timeout) {
+    unique_lock<std::mutex> lock(idleMutex);
+    wake.wait_for(lock, timeout, [this]() { return stopping || queued.load(memory_order_relaxed) > 0; });
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        if (runOne()) continue;
+
+        unique_lock<std::mutex> lock(idleMutex);
+        if (stopping && queued.load(memory_order_relaxed) == 0) break;
+        wake.wait(lock, [this]() { return stopping || queued.load(memory_order_relaxed) > 0; });
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "TaskPool.h"          // isReady
+
+// ------- WORK-STEALING POOL ------- //
+// Every worker owns a deque. Tasks submitted from a worker go to the back of its own deque and are
+// taken back LIFO (cache-warm, depth first); tasks submitted from outside are dealt round-robin. A worker
+// whose deque is empty steals the oldest task from another worker. Waiting for a result (get) runs other
+// tasks in the meantime, so a task may spawn sub-tasks and wait for them without starving the pool, e.g.
+// one task per video that spawns its frame analyses.
+class WorkStealingPool {
+public:
+    // threads = 0 uses one thread per hardware core
+    explicit WorkStealingPool(int threads = 0);
+    // Runs the tasks that are still queued, then joins the workers
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task) {
+        typedef typename std::result_of<F()>::type Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        push([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // Result of a future from submit(); runs queued tasks on the calling thread until it is ready
+    template <typename T>
+    T get(std::future<T>& future) {
+        while (!isReady(future)) {
+            if (!runOne()) waitForWork(std::chrono::milliseconds(1));
+        }
+        return future.get();
+    }
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+    // Tasks taken from another worker's deque so far
+    long long steals() const { return stealCount.load(std::memory_order_relaxed); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task);
+    // Runs one task from the own deque (LIFO) or stolen from another (FIFO); false if there was none
+    bool runOne();
+    bool take(int self, std::function<void()>& task);
+    void waitForWork(std::chrono::milliseconds timeout);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<long long> queued{ 0 };         // Tasks in all deques
+    std::atomic<unsigned> nextQueue{ 0 };       // Round-robin target for outside submissions
+    std::atomic<long long> stealCount{ 0 };
+    std::mutex idleMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
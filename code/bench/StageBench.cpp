@@ -0,0 +1,399 @@
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <algorithm>           // for sort, min, max
+#include <cmath>
+#include <cstdio>
+#include <iostream>            // Include standard I/O stream library
+#include <string>
+#include <vector>
+#include "SyntheticDrum.h"     // Generated footage with ground truth
+#include "AzimuthEnvelope.h"
+#include "BaselineDetector.h"
+#include "DrumRoi.h"
+#include "FrameAnalyzer.h"
+#include "FrameProcessing.h"
+#include "PyramidRefiner.h"
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+// ------- STAGE BENCHMARK ------- //
+// Times every stage of the per-frame loop and of the click analysis separately on synthetic drum footage
+// (see SyntheticDrum.h) and checks the results against the generated ground truth. Frame generation is
+// not timed. The exit code is non-zero if any correctness check fails.
+
+namespace {
+
+struct StageTimes {
+    explicit StageTimes(const string& name) : name(name) {}
+    string name;
+    vector<double> ms;   // One latency sample per call
+};
+
+struct Check {
+    string name;
+    bool passed;
+    string detail;
+};
+
+double elapsedMs(int64 startTicks) {
+    return (getTickCount() - startTicks) * 1000.0 / getTickFrequency();
+}
+
+// Nearest-rank percentile of a non-empty sample
+double percentile(vector<double> values, double p) {
+    sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[min(values.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+void printStages(const vector<StageTimes>& stages) {
+    printf("  %-18s %10s %10s %10s %8s\n", "stage", "frames/s", "p50 ms", "p99 ms", "samples");
+    for (const auto& stage : stages) {
+        if (stage.ms.empty()) continue;
+        double total = 0;
+        for (double ms : stage.ms) total += ms;
+        printf("  %-18s %10.1f %10.3f %10.3f %8d\n", stage.name.c_str(),
+               total > 0 ? stage.ms.size() * 1000.0 / total : 0.0,
+               percentile(stage.ms, 50), percentile(stage.ms, 99), static_cast<int>(stage.ms.size()));
+    }
+}
+
+string describe(const char* fmt, double a, double b = 0, double c = 0) {
+    char text[160];
+    snprintf(text, sizeof(text), fmt, a, b, c);
+    return text;
+}
+
+struct BenchOptions {
+    vector<string> resolutions{ "480p", "1080p", "4k" };
+    int frames = 64;            // Per-frame stages: frames per resolution (two drum turns)
+    int analysisRuns = 8;       // Click analysis + annotation runs per resolution
+};
+
+// Benchmarks one resolution; appends the correctness checks
+void benchResolution(const string& name, Size size, const BenchOptions& options, vector<Check>& checks) {
+    SyntheticDrum drum(DrumSpec::forSize(size));
+    const DrumSpec& spec = drum.config();
+    printf("\n==== %s (%dx%d): %d picks, %d frames ====\n", name.c_str(), size.width, size.height,
+           drum.laneCount(), options.frames);
+
+    StageTimes baselineStage("baseline"), maskStage("gray+mask"), accumulateStage("accumulate");
+    StageTimes lumaStage("luma+mask"), unfusedStage("mask+acc unfused"), contourStage("contours");
+    StageTimes frameStage("frame kernels"), roiStage("roi kernels"), pyramidStage("pyramid kernels");
+    StageTimes analysisStage("analysis"), annotateStage("annotate+encode");
+
+    float fixedBaselineY = -1;
+    int detectedRow = -1;
+    AzimuthEnvelope envelope;
+    int contourFrames = 0, contourMismatches = 0, fusedMismatches = 0;
+    double lumaError = 0;             // Both ranges, after the range decision of the source
+    int lumaRangeMisses = 0;
+
+    // ------- PER-FRAME STAGES ------- //
+    Mat gray, binary, referenceBinary, unfusedBinary, yuv;
+    vector<unsigned short> frameTops, referenceTops;
+    AzimuthEnvelope unfused;
+    vector<vector<Point>> contours;
+    for (int i = 0; i < options.frames; ++i) {
+        Mat frame = drum.frame(i);
+
+        int64 t = getTickCount();
+        cvtColor(frame, gray, COLOR_BGR2GRAY);
+        double grayMs = elapsedMs(t);
+
+        // Luma decode (--luma): the Y plane of a planar decoder buffer replaces the BGR -> gray conversion
+        cvtColor(frame, yuv, COLOR_BGR2YUV_I420);
+        Mat luma = yuv.rowRange(0, frame.rows);
+        if (i == 0 && !isStudioRange(luma, gray)) ++lumaRangeMisses;
+        t = getTickCount();
+        expandLumaRange(luma);
+        double lumaMs = elapsedMs(t);
+        lumaError = max(lumaError, norm(luma, gray, NORM_INF));
+
+        // A full-range Y plane (yuvj420p, MJPEG) must be recognized and used without the expansion
+        if (i == 0) {
+            Mat fullRange;
+            cvtColor(frame, fullRange, COLOR_BGR2YUV);
+            extractChannel(fullRange, fullRange, 0);
+            if (isStudioRange(fullRange, gray)) ++lumaRangeMisses;
+            lumaError = max(lumaError, norm(fullRange, gray, NORM_INF));
+        }
+
+        t = getTickCount();
+        int detectedY = BaselineDetector::detectRow(gray);
+        baselineStage.ms.push_back(elapsedMs(t));
+
+        // Keep the uppermost baseline like the player does (AnalysisSession::mergeBaseline)
+        if (detectedY != -1 && (fixedBaselineY == -1 || detectedY < fixedBaselineY)) {
+            detectedRow = detectedY;
+            fixedBaselineY = baselineFromRow(detectedY);
+        }
+        int cutoff = baselineCutoffRow(fixedBaselineY);
+
+        t = getTickCount();
+        GaussianBlur(gray, gray, Size(5, 5), 2);
+        frameTops.assign(gray.cols, AzimuthEnvelope::kEmpty);
+        fusedPickMask(gray, 11, 101, cutoff, binary, frameTops);
+        double maskMs = elapsedMs(t);
+        maskStage.ms.push_back(grayMs + maskMs);
+        lumaStage.ms.push_back(lumaMs + maskMs);   // Same blur and mask kernels on the Y plane
+
+        t = getTickCount();
+        envelope.merge(frameTops, cutoff);
+        accumulateStage.ms.push_back(elapsedMs(t));
+
+        // Separate threshold / mask / accumulate passes the fused kernel replaces, for comparison
+        t = getTickCount();
+        thresholdPickMask(gray, 11, 101, cutoff, unfusedBinary);
+        unfused.reset(gray.cols);
+        unfused.update(unfusedBinary, static_cast<int>(0.1 * gray.rows), cutoff);
+        unfusedStage.ms.push_back(elapsedMs(t));
+
+        // The vectorized kernel must match its scalar reference and the separate passes exactly
+        referenceTops.assign(gray.cols, AzimuthEnvelope::kEmpty);
+        fusedPickMaskReference(gray, 11, 101, cutoff, referenceBinary, referenceTops);
+        if (countNonZero(binary != referenceBinary) > 0 || countNonZero(binary != unfusedBinary) > 0 ||
+            frameTops != referenceTops || frameTops != unfused.rows()) {
+            ++fusedMismatches;
+        }
+
+        t = getTickCount();
+        findContours(binary, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        contourStage.ms.push_back(elapsedMs(t));
+
+        ++contourFrames;
+        if (static_cast<int>(contours.size()) != drum.visiblePicks(i)) ++contourMismatches;
+    }
+
+    // ------- DRUM ROI AND PYRAMID ------- //
+    // Region learned from the accumulated state after the turn, then the worker kernels (gray, baseline,
+    // blur, mask) on whole frames, on the region only (same baseline and tops) and coarse-to-fine on the
+    // first pyramid level (baseline and apex rows within the tolerance)
+    DrumRoi drumRoi;
+    const vector<unsigned short> noTops;
+    drumRoi.observe(0, size, noTops, Rect(), envelope, fixedBaselineY, true, 0, spec.framesPerTurn);
+    drumRoi.observe(spec.framesPerTurn, size, noTops, Rect(), envelope, fixedBaselineY, true, 0, spec.framesPerTurn);
+    const Rect roi = drumRoi.processed(size);
+
+    // A whole-frame probe with one pick column left of the region must start a new learning pass
+    DrumRoi probedRoi = drumRoi;
+    vector<unsigned short> outsideTops(size.width, AzimuthEnvelope::kEmpty);
+    if (roi.x > 0) outsideTops[roi.x / 2] = static_cast<unsigned short>(roi.y + roi.height / 2);
+    const bool probeRelearns = roi.x > 0 && probedRoi.observe(spec.framesPerTurn + 1, size, outsideTops,
+                                                              Rect(0, 0, size.width, size.height), envelope,
+                                                              fixedBaselineY, true, 0, spec.framesPerTurn)
+                               && probedRoi.region().empty();
+    const int cutoff = baselineCutoffRow(fixedBaselineY);
+    Mat roiGray, roiBinary;
+    Rect buffersRoi;
+    int roiMismatches = 0;
+    PyramidConfig pyramidConfig;
+    pyramidConfig.levels = 1;
+    PyramidRefiner pyramid;
+    Mat pyramidGray(size, CV_8UC1, Scalar(0)), pyramidBinary(size, CV_8UC1, Scalar(0));
+    vector<unsigned short> pyramidTops;
+    AzimuthEnvelope wholeEnvelope, pyramidEnvelope;
+    int pyramidRowError = 0;
+    for (int i = 0; i < options.frames; ++i) {
+        Mat frame = drum.frame(i);
+
+        int64 t = getTickCount();
+        int fullRow = detectBaselineRow(frame, gray, true);
+        fusedPickMask(gray, 11, 101, cutoff, binary, frameTops);
+        frameStage.ms.push_back(elapsedMs(t));
+
+        t = getTickCount();
+        clearOutsideRegion(size, roi, buffersRoi, roiGray, roiBinary);
+        int roiRow = detectBaselineRow(frame, roiGray, true, roi);
+        referenceTops.assign(size.width, AzimuthEnvelope::kEmpty);
+        fusedPickMask(roiGray, 11, 101, cutoff, roiBinary, referenceTops, roi);
+        roiStage.ms.push_back(elapsedMs(t));
+
+        if (roiRow != fullRow || referenceTops != frameTops || countNonZero(roiBinary != binary) > 0) ++roiMismatches;
+
+        t = getTickCount();
+        int pyramidRow = pyramid.detectBaselineRow(frame, true, Rect(0, 0, size.width, size.height), pyramidConfig);
+        pyramidTops.assign(size.width, AzimuthEnvelope::kEmpty);
+        pyramid.pickMask(11, 101, cutoff, pyramidGray, pyramidBinary, pyramidTops);
+        pyramidStage.ms.push_back(elapsedMs(t));
+
+        pyramidRowError = max(pyramidRowError, pyramidRow == -1 || fullRow == -1 ? (pyramidRow == fullRow ? 0 : size.height)
+                                                                                  : std::abs(pyramidRow - fullRow));
+        wholeEnvelope.merge(frameTops, cutoff);
+        pyramidEnvelope.merge(pyramidTops, cutoff);
+    }
+
+    // Apex rows of the accumulated envelopes (the heights a click measures)
+    int apexError = 0;
+    for (int lane = 0; lane < drum.laneCount(); ++lane) {
+        int x = drum.apex(lane).x;
+        if (x < 0 || x >= size.width) continue;
+        int whole = wholeEnvelope.rows()[x], coarse = pyramidEnvelope.rows()[x];
+        apexError = max(apexError, whole == AzimuthEnvelope::kEmpty || coarse == AzimuthEnvelope::kEmpty
+                                       ? (whole == coarse ? 0 : size.height) : std::abs(whole - coarse));
+    }
+
+    // All pick columns of the envelopes: none may be lost on the level, the rows stay within the tolerance
+    int wholeColumns = 0, pyramidColumns = 0, envelopeMaxError = 0;
+    double envelopeErrorSum = 0;
+    for (int x = 0; x < size.width; ++x) {
+        int whole = wholeEnvelope.rows()[x], coarse = pyramidEnvelope.rows()[x];
+        if (whole == AzimuthEnvelope::kEmpty) continue;
+        ++wholeColumns;
+        if (coarse == AzimuthEnvelope::kEmpty) continue;
+        ++pyramidColumns;
+        envelopeErrorSum += std::abs(whole - coarse);
+        envelopeMaxError = max(envelopeMaxError, std::abs(whole - coarse));
+    }
+    const double envelopeCoverage = wholeColumns > 0 ? static_cast<double>(pyramidColumns) / wholeColumns : 1;
+    const double envelopeMeanError = pyramidColumns > 0 ? envelopeErrorSum / pyramidColumns : 0;
+
+    // ------- CLICK ANALYSIS STAGES ------- //
+    AnalyzerParams params;
+    AnalysisResult result;
+    vector<uchar> encoded;
+    for (int run = 0; run < options.analysisRuns; ++run) {
+        Mat frame = drum.frame(run * spec.framesPerTurn / max(1, options.analysisRuns));
+
+        int64 t = getTickCount();
+        result = FrameAnalyzer::analyze(frame, envelope, fixedBaselineY, 0.0, params);
+        analysisStage.ms.push_back(elapsedMs(t));
+
+        t = getTickCount();
+        Mat annotated = FrameAnalyzer::annotate(frame, result);
+        imencode(".png", annotated, encoded);
+        annotateStage.ms.push_back(elapsedMs(t));
+    }
+
+    printStages({ baselineStage, maskStage, lumaStage, accumulateStage, unfusedStage, contourStage, frameStage, roiStage,
+                  pyramidStage, analysisStage, annotateStage });
+
+    // ------- CORRECTNESS AGAINST GROUND TRUTH ------- //
+    checks.push_back({ name + " baseline", detectedRow != -1 && std::abs(detectedRow - spec.baselineRow) <= 3,
+                       describe("detected row %.0f, true edge row %.0f", detectedRow, spec.baselineRow) });
+
+    // Envelope after at least one full turn: flank rows of the picks per column
+    if (options.frames >= spec.framesPerTurn) {
+        vector<unsigned short> truth = drum.envelopeTruth();
+        const vector<unsigned short>& rows = envelope.rows();
+        int truthColumns = 0, coveredColumns = 0;
+        double errorSum = 0;
+        for (size_t x = 0; x < truth.size() && x < rows.size(); ++x) {
+            if (truth[x] == AzimuthEnvelope::kEmpty) continue;
+            ++truthColumns;
+            if (rows[x] == AzimuthEnvelope::kEmpty) continue;
+            ++coveredColumns;
+            errorSum += std::abs(static_cast<int>(rows[x]) - static_cast<int>(truth[x]));
+        }
+        double coverage = truthColumns > 0 ? static_cast<double>(coveredColumns) / truthColumns : 0;
+        double meanError = coveredColumns > 0 ? errorSum / coveredColumns : 0;
+        checks.push_back({ name + " envelope", coverage >= 0.9 && meanError <= 4.0,
+                           describe("%.1f%% of pick columns covered, mean row error %.2f px", coverage * 100, meanError) });
+    }
+
+    checks.push_back({ name + " fused mask", fusedMismatches == 0,
+                       describe("%.0f of %.0f frames differ from the scalar reference or the separate passes", fusedMismatches, contourFrames) });
+
+    checks.push_back({ name + " luma range", lumaError <= 2 && lumaRangeMisses == 0,
+                       describe("studio and full range Y planes differ from BGR -> gray by up to %.0f levels, "
+                                "%.0f of 2 ranges misjudged", lumaError, lumaRangeMisses) });
+
+    checks.push_back({ name + " drum roi", !drumRoi.region().empty() && roiMismatches == 0 && probeRelearns,
+                       describe("region %.0f%% of the frame, %.0f of %.0f frames differ from the whole-frame kernels",
+                                100 * drumRoi.coverage(size), roiMismatches, options.frames)
+                           + (probeRelearns ? ", a probe outside re-learns it" : ", a probe outside is missed") });
+
+    checks.push_back({ name + " pyramid", pyramidRowError <= pyramidConfig.tolerance && apexError <= pyramidConfig.tolerance,
+                       describe("baseline row off by up to %.0f, apex rows by up to %.0f px (tolerance %.0f)",
+                                pyramidRowError, apexError, pyramidConfig.tolerance) });
+
+    checks.push_back({ name + " pyramid envelope", envelopeCoverage >= 0.99 && envelopeMeanError <= pyramidConfig.tolerance,
+                       describe("%.1f%% of pick columns kept, row error mean %.2f, max %.0f px", envelopeCoverage * 100,
+                                envelopeMeanError, envelopeMaxError) });
+
+    checks.push_back({ name + " contours", contourMismatches <= contourFrames / 20,
+                       describe("%.0f of %.0f frames with a contour count != visible picks", contourMismatches, contourFrames) });
+
+    if (options.analysisRuns > 0 && options.frames >= spec.framesPerTurn) {
+        // Every lane apex must appear as an azimuth pick (red dot)
+        int found = 0;
+        for (int lane = 0; lane < drum.laneCount(); ++lane) {
+            Point apex = drum.apex(lane) * result.scale;
+            for (const auto& pick : result.azimuthPicks) {
+                if (std::abs(pick.position.x - apex.x) <= 3 * result.scale && std::abs(pick.position.y - apex.y) <= 10 * result.scale) {
+                    ++found;
+                    break;
+                }
+            }
+        }
+        checks.push_back({ name + " azimuth picks", found == drum.laneCount() && static_cast<int>(result.azimuthPicks.size()) == drum.laneCount(),
+                           describe("%.0f of %.0f apexes found, %.0f red dots", found, drum.laneCount(), static_cast<double>(result.azimuthPicks.size())) });
+
+        double trueSpacing = spec.spacing * result.scale;
+        checks.push_back({ name + " cutting spacing", std::abs(result.cuttingSpacing - trueSpacing) <= 0.05 * trueSpacing,
+                           describe("estimated %.0f px, true %.0f px (zoomed)", result.cuttingSpacing, trueSpacing) });
+    }
+}
+
+vector<string> splitList(const string& text) {
+    vector<string> items;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == string::npos) comma = text.size();
+        if (comma > pos) items.push_back(text.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    return items;
+}
+
+void printUsage() {
+    cout << "Usage: stage_bench [--res 480p,1080p,4k] [--frames N] [--analysis-runs N]" << endl;
+    cout << "  --res <list>          resolutions to benchmark (default 480p,1080p,4k)" << endl;
+    cout << "  --frames <N>          frames for the per-frame stages (default 64 = two drum turns)" << endl;
+    cout << "  --analysis-runs <N>   click analysis + annotation runs (default 8)" << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--res" && hasValue) options.resolutions = splitList(argv[++i]);
+            else if (arg == "--frames" && hasValue) options.frames = stoi(argv[++i]);
+            else if (arg == "--analysis-runs" && hasValue) options.analysisRuns = stoi(argv[++i]);
+            else {
+                printUsage();
+                return arg == "--help" ? 0 : -1;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        cerr << "Error: Invalid numeric argument." << endl;
+        printUsage();
+        return -1;
+    }
+
+    printf("OpenCV %s, %d threads, SIMD: %s\n", CV_VERSION, getNumThreads(), checkHardwareSupport(CV_CPU_AVX2) ? "AVX2" : "baseline");
+
+    vector<Check> checks;
+    for (const string& name : options.resolutions) {
+        Size size = DrumSpec::resolution(name);
+        if (size.area() == 0) {
+            cerr << "Error: Unknown resolution " << name << endl;
+            return -1;
+        }
+        benchResolution(name, size, options, checks);
+    }
+
+    int failed = 0;
+    printf("\n==== Correctness ====\n");
+    for (const auto& check : checks) {
+        printf("  [%s] %-24s %s\n", check.passed ? "PASS" : "FAIL", check.name.c_str(), check.detail.c_str());
+        if (!check.passed) ++failed;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "SyntheticDrum.h"
+#include <algorithm>           // for min, max
+#include <cmath>
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+const int kBackgroundGray = 20;
+const int kDrumGray = 70;      // Below the default threshold (101 - 11), never part of the pick mask
+const int kPickGray = 210;
+const double kPi = 3.14159265358979323846;
+
+} // namespace
+
+DrumSpec DrumSpec::forSize(Size size) {
+    DrumSpec spec;
+    spec.size = size;
+    spec.baselineRow = size.height * 72 / 100;
+
+    spec.spacing = 40;
+    spec.firstPickX = spec.spacing;
+    spec.baseHalfWidth = 16;
+    int lanes = size.width / spec.spacing - 1;
+    for (int lane = 0; lane < lanes; ++lane) {
+        spec.maxHeights.push_back(40 + 8 * (lane * 3 % 4));  // 40..64 px, neighbours differ
+    }
+    return spec;
+}
+
+Size DrumSpec::resolution(const string& name) {
+    if (name == "480p") return Size(640, 480);
+    if (name == "1080p") return Size(1920, 1080);
+    if (name == "4k") return Size(3840, 2160);
+    return Size();
+}
+
+int SyntheticDrum::pickHeight(int lane, long long frameIndex) const {
+    long long phase = (frameIndex + static_cast<long long>(lane) * spec.phaseLag) % spec.framesPerTurn;
+    double s = std::sin(2.0 * kPi * static_cast<double>(phase) / spec.framesPerTurn);
+    return s > 0 ? cvRound(spec.maxHeights[lane] * s) : 0;
+}
+
+int SyntheticDrum::visiblePicks(long long frameIndex) const {
+    int count = 0;
+    for (int lane = 0; lane < laneCount(); ++lane) {
+        if (pickHeight(lane, frameIndex) >= minVisibleHeight) ++count;
+    }
+    return count;
+}
+
+Mat SyntheticDrum::frame(long long frameIndex) const {
+    Mat gray(spec.size, CV_8UC1, Scalar(kBackgroundGray));
+
+    // Picks first, the drum body then covers their base below the baseline
+    for (int lane = 0; lane < laneCount(); ++lane) {
+        int height = pickHeight(lane, frameIndex);
+        if (height < minVisibleHeight) continue;
+
+        int x = laneX(lane);
+        vector<Point> triangle{
+            Point(x, spec.baselineRow - height),
+            Point(x - spec.baseHalfWidth, spec.baselineRow),
+            Point(x + spec.baseHalfWidth, spec.baselineRow)
+        };
+        fillConvexPoly(gray, triangle, Scalar(kPickGray));
+    }
+    gray.rowRange(spec.baselineRow, gray.rows).setTo(kDrumGray);
+
+    // Deterministic sensor noise per frame
+    if (spec.noiseSigma > 0) {
+        RNG rng(0x5eedULL + static_cast<uint64>(frameIndex));
+        Mat noisy, noise(spec.size, CV_16SC1);
+        rng.fill(noise, RNG::NORMAL, 0, spec.noiseSigma);
+        gray.convertTo(noisy, CV_16SC1);
+        noisy += noise;
+        noisy.convertTo(gray, CV_8UC1);   // Saturates to 0..255
+    }
+
+    Mat bgr;
+    cvtColor(gray, bgr, COLOR_GRAY2BGR);
+    return bgr;
+}
+
+vector<unsigned short> SyntheticDrum::envelopeTruth() const {
+    vector<unsigned short> top(spec.size.width, 0xFFFF);
+    for (int lane = 0; lane < laneCount(); ++lane) {
+        int height = spec.maxHeights[lane];
+        for (int dx = -spec.baseHalfWidth; dx <= spec.baseHalfWidth; ++dx) {
+            int x = laneX(lane) + dx;
+            if (x < 0 || x >= spec.size.width) continue;
+
+            // Flank of the triangle at full height
+            int row = cvRound(spec.baselineRow - height + std::abs(dx) * static_cast<double>(height) / spec.baseHalfWidth);
+            if (row < spec.baselineRow) {
+                top[x] = static_cast<unsigned short>(min<int>(top[x], row));
+            }
+        }
+    }
+    return top;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <opencv2/opencv.hpp>  // Include OpenCV's core functionality
+#include <string>
+#include <vector>
+
+// ------- SYNTHETIC DRUM FOOTAGE ------- //
+// Generated rotating cutter drum frames with known geometry, so every stage of the pipeline can be timed
+// on footage of any resolution and checked against ground truth. Side view: a dark background, the drum
+// body (mid gray) below the baseline row and bright triangular picks standing on the baseline at
+// equidistant x lanes. While the drum turns, every pick rises and falls with its own phase; it reaches its
+// full height (the azimuth) exactly once per turn, on a whole frame.
+
+struct DrumSpec {
+    cv::Size size;
+    int baselineRow = 0;           // First row of the drum body (the baseline edge)
+    int firstPickX = 0;            // x of lane 0
+    int spacing = 0;               // Distance between neighbouring lanes (cutting line distance)
+    int baseHalfWidth = 0;         // Half width of a pick at the baseline
+    std::vector<int> maxHeights;   // Full height above the baseline per lane (px)
+    int framesPerTurn = 32;        // Frames of one drum revolution (multiple of 4)
+    int phaseLag = 5;              // Phase offset between neighbouring lanes (frames)
+    double noiseSigma = 4.0;       // Gaussian sensor noise (gray levels)
+
+    // Spec for a frame size: baseline at 72% of the height and picks of a fixed pixel size (40 px lanes,
+    // 40..64 px tall) across the whole width, so higher resolutions carry proportionally more picks.
+    // The picks are narrower than the 80 px (zoomed) red dot neighborhood, so every lane yields exactly
+    // one azimuth pick at its apex.
+    static DrumSpec forSize(cv::Size size);
+    // "480p", "1080p" or "4k"; empty size for unknown names
+    static cv::Size resolution(const std::string& name);
+};
+
+class SyntheticDrum {
+public:
+    explicit SyntheticDrum(const DrumSpec& spec) : spec(spec) {}
+
+    const DrumSpec& config() const { return spec; }
+    int laneCount() const { return static_cast<int>(spec.maxHeights.size()); }
+    int laneX(int lane) const { return spec.firstPickX + lane * spec.spacing; }
+
+    // Visible height of a pick in a frame (0 while it is behind the drum)
+    int pickHeight(int lane, long long frameIndex) const;
+    // Picks drawn in a frame (visible height of at least minVisibleHeight px)
+    int visiblePicks(long long frameIndex) const;
+
+    // BGR frame with deterministic noise
+    cv::Mat frame(long long frameIndex) const;
+
+    // Expected azimuth envelope after a full turn: top row of the picks per column, 0xFFFF where none
+    std::vector<unsigned short> envelopeTruth() const;
+    // Apex (highest point) of a pick at its full height
+    cv::Point apex(int lane) const { return cv::Point(laneX(lane), spec.baselineRow - spec.maxHeights[lane]); }
+
+    static const int minVisibleHeight = 8;
+
+private:
+    DrumSpec spec;
+};
@@ -4,487 +4,415 @@
 #include <algorithm>           // for sort, abs
 #include <numeric>             // for accumulate
 #include <fstream>             // For file output
+#include <deque>               // Pending click analyses
+#include <mutex>
+#include <sstream>             // Per-video batch reports
+#include <chrono>              // Frame timing for the telemetry
+#include <stdexcept>           // Malformed sweep ranges
+#include <memory>              // Video file / frame stream source
+#include "FrameProcessing.h"   // Per-frame baseline / pick mask kernels
+#include "FramePipeline.h"     // Decoder / analysis / display pipeline
+#include "AzimuthEnvelope.h"   // Per-column upper outline of the accumulated picks
+#include "FrameAnalyzer.h"     // Click analysis (azimuth picks, tips, cutting lines)
+#include "TaskPool.h"          // Worker threads for the click analysis
+#include "Telemetry.h"         // Stage timers, counters, HUD and telemetry export
+#include "AnalysisSession.h"   // Per-video analysis state and batch analysis
+#include "WorkStealingPool.h"  // Multi-video batch scheduler
+#include "ExportQueue.h"       // Background encoders for the annotated frames
+#include "ParameterSweep.h"    // Brightness / threshold sweep from one decode
+#include "StreamSource.h"      // Raw frames from stdin, a named pipe or a shared-memory ring
+#include "PlaybackScheduler.h" // Timestamp-driven pacing of the player
+#include "AllocationCounter.h" // Debug check of the allocation-free frame loop
 //#include <Magick++.h>          // Include ImageMagick++ for EPS conversion
 
 using namespace cv;            // Use the cv namespace to simplify OpenCV code
 using namespace std;           // Use the std namespace for standard library
 
-// Global variables to store the current and selected video frames
-Mat currentFrame;              // Frame currently being displayed in the video loop
-Mat selectedFrame;             // Frame selected by clicking with the mouse
-double currentTimestamp = 0.0; // Store current video timestamp in ms
-float fixedBaselineY = -1;      // Will store the uppermost baseline detected
-string baseName = "frame";      // fallback name, will be set in main()
-
-// Global variables for trackbar values
-int brightnessValue = 11;        // Brightness offset, default = 11
-int thresholdValue = 101;        // Binary threshold, default = 101
-int prevBrightnessValue = -1;   // Previous brightness value before user adjustment
-int prevThresholdValue = -1;    // Previous threshold value before user adjustment
-
-// Global for accumulated binary
-Mat accumulatedBinary;           // Stores merged binary masks across frames
-bool isFirstBinary = true;       // Flag to initialize accumulatedBinary
-
-vector<Point> recordedRedCircles; // Stores red dot positions across clicks
-
-// Utility function to draw dashed lines
-void drawDashedLine(Mat& img, Point start, Point end, Scalar color, int dashLength = 10, int gapLength = 5, int thickness = 1) {
-    for (int y = start.y; y < end.y; y += dashLength + gapLength) {
-        int yEnd = min(y + dashLength, end.y);
-        line(img, Point(start.x, y), Point(end.x, yEnd), color, thickness);
-    }
-}
+// Clicked frames whose analysis runs on the worker pool, oldest first
+struct ClickQueue {
+    AnalysisSession* session = nullptr;   // Session of the video being played
+    TaskPool pool{ 2 };
+    deque<future<ClickAnalysis>> pending;
+};
 
 // Mouse callback function: triggered when user clicks on the video frame
 void onMouse(int event, int x, int y, int flags, void* userdata) {
-    // Only respond to left-click and if a frame exists
-    if (event == EVENT_LBUTTONDOWN && !currentFrame.empty()) {
+    ClickQueue* clicks = static_cast<ClickQueue*>(userdata);
+    AnalysisSession& session = *clicks->session;
 
-        // Reset red dot memory for every click
-        recordedRedCircles.clear();
-
-        // Clone the current frame into selectedFrame
-        selectedFrame = currentFrame.clone();
+    // Only respond to left-click and if a frame exists
+    if (event == EVENT_LBUTTONDOWN && !session.currentFrame.empty()) {
 
-        // Create a 4-fold xy-resampled(4x zoomed) version of the selected frame
-        Mat zoomed;
-        resize(selectedFrame, zoomed, Size(), 4.0, 4.0, INTER_LINEAR);  // INTER_LINEAR = smooth scaling
+        // Snapshot of the click: setCurrentFrame never overwrites a buffer a click still holds, so sharing it is enough
+        Mat selectedFrame = session.currentFrame;
+        AzimuthEnvelope envelope = session.azimuthEnvelope;
+        float baselineY = session.fixedBaselineY;
+        double timestampMs = session.currentTimestamp;
+        AnalyzerParams params = session.currentAnalyzerParams();
+        OutputOptions output = session.output;
 
         // Convert current timestamp from milliseconds to seconds
-        int timestamp_sec = static_cast<int>(currentTimestamp / 1000.0);
-
-        string outTextPath = "Outputs/" + baseName + "_measurements.txt"; // Measurement file output
-        ofstream outFile(outTextPath); // Overwrite data with every user click
+        int timestamp_sec = static_cast<int>(session.currentTimestamp / 1000.0);
 
         // Compose a filename using video name and timestamp
         // string filename = baseName + "_" + to_string(timestamp_sec) + "s.png";
-        string filename = "Outputs/" + baseName + "_" + to_string(timestamp_sec) + "s.png";
-
-
-        // ------- AZIMUTH CONTOUR BUILD START ------- //
-
-       // Create the scaled original image first
-        Mat originalZoomed;
-        resize(selectedFrame, originalZoomed, Size(), 4.0, 4.0, INTER_LINEAR);
-
-        vector<vector<Point>> mergedContours;  // Single declaration
-
-        if (!accumulatedBinary.empty()) {
-            findContours(accumulatedBinary, mergedContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-            for (const auto& contour : mergedContours) {
-                // --- Original: Draw detailed blue contour (after green-to-blue pass) ---
-                vector<Point> scaledContour;
-                for (const Point& pt : contour) {
-                    scaledContour.push_back(pt * 4);
-                }
-                drawContours(zoomed, vector<vector<Point>>{scaledContour}, -1, Scalar(0, 255, 0), 2);
-
-
-                // ------- AZIMUTH PICK TIP DETECTION START ------- //
-
-                // --- Draw violet simplified contour using approxPolyDP ---
-                vector<Point> approx;
-                double epsilon = 0.0025 * arcLength(contour, true);  // Tuning parameter: smaller epsilon = more detail
-                approxPolyDP(contour, approx, epsilon, true);
-
-                // Scale approximated poly corner point           
-                vector<Point> redCirclePoints;
-                for (const auto& pt : approx) {
-                    Point scaledPt = pt * 4;
-                    redCirclePoints.push_back(scaledPt);  // Store the red dot position                  
-                }
-
-                // (Optional) Draw the simplified contour in violet (BGR: 255, 0, 255)
-                //drawContours(zoomed, vector<vector<Point>>{scaledApprox}, -1, Scalar(255, 0, 255), 2);
-
-
-                // Filter close red dots to retain only the highest one (smallest y) in each horizontal neighborhood
-                // Red dots within 80px of each other are considered overlapping candidates
-                vector<bool> replaced(redCirclePoints.size(), false);
-
-                // Loop through each red circle point
-                for (size_t i = 0; i < redCirclePoints.size(); ++i) {
-                    if (replaced[i]) continue; // Skip if already replaced
-
-                    Point pt1 = redCirclePoints[i];  // Current red circle point
-
-                    // Compare pt1 with the rest of the points to its right
-                    for (size_t j = i + 1; j < redCirclePoints.size(); ++j) {
-                        if (replaced[j]) continue;
-
-                        Point pt2 = redCirclePoints[j];
-
-                        // Check if the two points are horizontally close within 80 px
-                        if (abs(pt2.x - pt1.x) <= 80) {
-                            // If both points are horizontally close, keep the one higher on frame
-                            if (pt1.y < pt2.y) {
-                                replaced[j] = true; // if pt1 is higher (smaller y), keep pt1, discard pt2
-                            }
-                            else {
-                                replaced[i] = true; // if pt2 is higher, discard pt1
-                                break;  // Exit early since pt1 is no longer valid
-                            }
-                        }
-                    }
-                }
-                // ------- AZIMUTH PICK TIP DETECTION END ------- //
-
-
-                // ------- AZIMUTH PICK TIP COORDINATE RECORD START ------- //
-
-                // After filtering: record coordinates only final red dots
-                for (size_t i = 0; i < redCirclePoints.size(); ++i) {
-                    if (!replaced[i]) {
-                        recordedRedCircles.push_back(redCirclePoints[i]);
-                    }
-                }
-
-
-                // Optional: Print final red circle coordinates after filtering
-                //cout << "Final red circle coordinates after filtering:" << endl;
-                //for (const auto& pt : recordedRedCircles) {
-                //    cout << "(" << pt.x << ", " << zoomed.rows - pt.y << ")" << endl;
-                //}
-
-                if (fixedBaselineY != -1) {
-                    int zoomedBaselineY = fixedBaselineY * 4;
-                    cout << "\n[AZIMUTH] Pick Count, X-position and Height in Azimuth Contour:\n\n";
-                    cout << "  Azimuth Pick Count in Video: " << recordedRedCircles.size() << endl;
-
-                    outFile << "[AZIMUTH] Pick Count, X-position and Height in Azimuth Contour:\n\n";
-                    outFile << "  Azimuth Pick Count in Video: " << recordedRedCircles.size() << endl;
-
-                    for (const auto& pt : recordedRedCircles) {
-                        int height = zoomedBaselineY - pt.y;
-                        cout << "  Azimuth Pick at x-position " << pt.x << " px with Pick Height: " << height << " px\n";
-                        outFile << "  Azimuth Pick at x-position " << pt.x << " px with Pick Height: " << height << " px\n";
-
-                        // Draw red circle
-                        circle(zoomed, pt, 4, Scalar(0, 0, 255), FILLED);  // Red dot
-
-                        // Coordinate label
-                        string coordText = "(" + to_string(pt.x) + "," + to_string(zoomed.rows - pt.y) + ")";
-                        int textX = pt.x + 5;
-                        int textY = pt.y - 5;
-
-                        if (pt.x > zoomed.cols - 100) {
-                            textX = pt.x - 70;   // move left if near right edge
-                            textY = pt.y + 15;
-                        }
-
-                        putText(zoomed, coordText, Point(textX, textY), FONT_HERSHEY_PLAIN, 0.9, Scalar(255, 255, 255), 1);
-
-                        // Height label (placed slightly below the coordinate label)
-                        string heightText = "H: " + to_string(height) + "px";
-                        putText(zoomed, heightText, Point(textX, textY + 12), FONT_HERSHEY_PLAIN, 0.9, Scalar(180, 180, 255), 1);
-                    }
-                }
-
-
-                // ------- AZIMUTH PICK TIP COORDINATE RECORD ENDS ------- //
-
-
-                // ------- PRELIMINARY CONTOUR + PICK AZIMUTH MATCHING START ------- //
-
-                // Step 1: Get pick tip coordinates from current frame
-                vector<vector<Point>> pickContours;
-                Mat gray, brightGray, binary;
-                cvtColor(selectedFrame, gray, COLOR_BGR2GRAY);
-                add(gray, Scalar(brightnessValue), brightGray);
-                threshold(brightGray, binary, thresholdValue, 255, THRESH_BINARY);
-
-                // Mask top 10% of the frame
-                int ignoreTop = static_cast<int>(0.1 * binary.rows);
-                binary.rowRange(0, ignoreTop).setTo(0);
-
-                // Mask below baseline if available
-                if (fixedBaselineY != -1) {
-                    binary.rowRange(static_cast<int>(fixedBaselineY), binary.rows).setTo(0);
-                }
-
-                findContours(binary, pickContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-                vector<Point> pickTips;
-                int blockWidth = 500;  // Width of each horizontal scan block
-
-                // Scale all contour points first and collect them
-                vector<Point> allPoints;
-                for (const auto& contour : pickContours) {
-                    for (const auto& pt : contour) {
-                        allPoints.push_back(pt * 4);  // Scale to zoomed frame
-                    }
-                }
-
-                // Scan in 50px horizontal blocks
-                for (int xStart = 0; xStart < selectedFrame.cols * 4; xStart += blockWidth) {
-                    int xEnd = xStart + blockWidth;
-
-                    Point minYPoint(-1, INT_MAX);  // INT_MAX = very large value
-                    bool found = false;
-
-                    for (const auto& pt : allPoints) {
-                        if (pt.x >= xStart && pt.x < xEnd) {
-                            if (pt.y < minYPoint.y) {
-                                minYPoint = pt;
-                                found = true;
-                            }
-                        }
-                    }
-
-                    if (found) {
-                        pickTips.push_back(minYPoint);
-                    }
-                }
-
-
-                // Step 2: Match against red circles
-                vector<Point> matchedTips;
-                set<int> usedRedIndices;
-
-                double maxDist = 50.0;
-                for (const Point& tip : pickTips) {
-                    double bestDist = maxDist;
-                    int bestIndex = -1;
-
-                    for (size_t i = 0; i < recordedRedCircles.size(); ++i) {
-                        if (usedRedIndices.count(i)) continue;  // Skip already matched
-
-                        double dist = norm(tip - recordedRedCircles[i]);
-                        if (dist < bestDist) {
-                            bestDist = dist;
-                            bestIndex = static_cast<int>(i);
-                        }
-                    }
-
-                    if (bestIndex != -1) {
-                        matchedTips.push_back(tip);
-                        usedRedIndices.insert(bestIndex);
-                    }
-                }
+        string filename = session.outputPath("_" + to_string(timestamp_sec) + "s.png");
 
+        // Queue the analysis; playback continues while it runs
+        clicks->pending.push_back(clicks->pool.submit([=]() {
+            return AnalysisSession::runAnalysis(selectedFrame, envelope, baselineY, timestampMs, params, filename, true, output);
+        }));
+    }
+}
 
-                // Step 3: Output and highlight
-                if (!matchedTips.empty()) {
-                    cout << "\n[AZIMUTH] Pick(s) in Azimuth at timeframe " << timestamp_sec << "s:\n" << endl;
-                    cout << "  Azimuth Pick Count in this Frame: " << matchedTips.size() << endl;
+// Reports and shows every finished click analysis, in click order (GUI thread, never waits)
+void collectClickResults(ClickQueue& clicks) {
+    while (!clicks.pending.empty() && isReady(clicks.pending.front())) {
+        future<ClickAnalysis> done = move(clicks.pending.front());
+        clicks.pending.pop_front();
 
-                    outFile << "\n[AZIMUTH] Pick(s) in Azimuth timeframe " << timestamp_sec << "s:\n" << endl;
-                    outFile << "  Azimuth Pick Count in this Frame: " << matchedTips.size() << endl;
-                    for (const Point& tip : matchedTips) {
-                        int zoomedBaselineY = fixedBaselineY * 4; // Scale baseline to match zoomed image
-                        int heightAboveBaseline = zoomedBaselineY - tip.y;
-                        //cout << "  Pick Tip: (" << tip.x << ", " << zoomed.rows - tip.y << ") -> Height above baseline: " << heightAboveBaseline << " px" << endl;
-                        cout << "  Azimuth Pick at x-position " << tip.x << " px with Pick Height: " << heightAboveBaseline << " px" << endl;
-                        outFile << "  Azimuth Pick at x-position " << tip.x << " px with Pick Height: " << heightAboveBaseline << " px" << endl;
+        try {
+            ClickAnalysis analysis = done.get();
 
+            string outTextPath = clicks.session->outputPath("_measurements.txt"); // Measurement file output
+            ofstream outFile(outTextPath, ios::app); // Every click adds to the history of this video
+            outFile << "\n========== Frame at " << static_cast<int>(analysis.result.timestampMs) << " ms ==========\n";
+            FrameAnalyzer::printMeasurements(analysis.result, cout, outFile);
+            clicks.session->recordMeasurements(analysis.result);  // Binary log for trend queries
 
-                        // Yellow circle
-                        circle(zoomed, tip, 6, Scalar(0, 255, 255), 2);
+            // Show the zoomed image in a new window
+            imshow("Resampled Frame", analysis.annotated);
+            cout << "\nSaved resampled frame as: " << analysis.filename << endl;
+        }
+        catch (const std::exception& e) {
+            cerr << "Click analysis failed: " << e.what() << endl;
+        }
+    }
+}
 
+// Create the Outputs folder next to the executable (no-op if it already exists)
+void createOutputFolder() {
+#ifdef _WIN32
+    system("mkdir Outputs >nul 2>&1"); // null suppresses output, 2>&1 redirects error to null
+#else
+    system("mkdir -p Outputs >/dev/null 2>&1");
+#endif
+}
 
-                        // Create coordinate text
-                        string coordText2 = "(" + to_string(tip.x) + "," + to_string(zoomed.rows - tip.y) + ")";
-                        int textX = tip.x + 5;
-                        int textY = tip.y - 30;
+// Multi-video batch: every video of a folder gets its own session and output files. The videos are the
+// tasks of a work-stealing pool; each one spawns its frame analyses on the same pool, so idle cores pick
+// up analyses of long videos once the short ones are done.
+int runBatchFolder(const BatchOptions& options) {
+    vector<string> videos;
+    for (const char* pattern : { "*.mp4", "*.avi", "*.mov", "*.mkv" }) {
+        vector<string> matches;
+        glob(options.videoDir + "/" + pattern, matches, false);  // false = this folder only
+        videos.insert(videos.end(), matches.begin(), matches.end());
+    }
+    sort(videos.begin(), videos.end());
+    if (videos.empty()) {
+        cerr << "Error: No videos found in " << options.videoDir << endl;
+        return -1;
+    }
 
-                        if (tip.x > zoomed.cols - 100) {
-                            textX = tip.x - 70;   // move left if near right edge
-                            textY = tip.y - 30;   // move text below
-                        }
+    WorkStealingPool scheduler(options.pipeline.workers);
+    cout << "[BATCH] " << videos.size() << " video(s) on " << scheduler.threadCount() << " threads" << endl;
+
+    mutex consoleMutex;
+    vector<future<int>> results;
+    for (const string& video : videos) {
+        results.push_back(scheduler.submit([&options, &scheduler, &consoleMutex, video]() {
+            AnalysisSession session(video, options.output);
+            ostringstream report;    // Printed in one piece, so the reports of parallel videos don't interleave
+            int status = session.runBatch(options, report, &scheduler);
+
+            lock_guard<mutex> lock(consoleMutex);
+            cout << report.str();
+            return status;
+        }));
+    }
 
-                        putText(zoomed, coordText2, Point(textX, textY), FONT_HERSHEY_PLAIN, 0.9, Scalar(0, 255, 255), 1);
+    int failed = 0;
+    for (auto& result : results) {
+        if (scheduler.get(result) != 0) ++failed;
+    }
 
-                        string heightText = "True Pick Height: " + to_string(heightAboveBaseline) + " px";
-                        putText(zoomed, heightText, Point(textX, textY + 80), FONT_HERSHEY_PLAIN, 0.9, Scalar(127, 0, 255), 1);
+    cout << "\n[BATCH] " << videos.size() - failed << " of " << videos.size() << " video(s) analyzed ("
+         << scheduler.steals() << " tasks stolen)" << endl;
+    return failed == 0 ? 0 : -1;
+}
 
+// Parse a comma separated list of seconds ("1.0,2.5,10")
+vector<double> parseSecondsList(const string& text) {
+    vector<double> values;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == string::npos) comma = text.size();
+        if (comma > pos) values.push_back(stod(text.substr(pos, comma - pos)));
+        pos = comma + 1;
+    }
+    return values;
+}
 
-                        // PRELIMINARY SEMI-TRIANGULAR CONTOURS
+// Parse a "WxH" frame size ("1920x1080")
+Size parseSize(const string& text) {
+    size_t x = text.find_first_of("xX");
+    if (x == string::npos) throw invalid_argument(text);
+    return Size(stoi(text.substr(0, x)), stoi(text.substr(x + 1)));
+}
 
-                        // Define triangle below the tip
-                        int triHeight = 300;  // vertical size
-                        int triWidth = 400;   // horizontal base width
+// Parse a raw stream pixel format ("gray" / "bgr"); false if unknown
+bool parseStreamFormat(const string& text, StreamPixelFormat& format) {
+    if (text == "gray") format = StreamPixelFormat::Gray;
+    else if (text == "bgr") format = StreamPixelFormat::Bgr;
+    else return false;
+    return true;
+}
 
-                        Point pt1 = tip;  // tip of triangle
-                        Point pt2(tip.x - triWidth / 2, tip.y + triHeight);
-                        Point pt3(tip.x + triWidth / 2, tip.y + triHeight);
+// Parse a late frame policy ("none" / "display" / "analysis"); false if unknown
+bool parseLatePolicy(const string& text, LatePolicy& policy) {
+    if (text == "none") policy = LatePolicy::None;
+    else if (text == "display") policy = LatePolicy::Display;
+    else if (text == "analysis") policy = LatePolicy::Analysis;
+    else return false;
+    return true;
+}
 
-                        vector<Point> triangle{ pt1, pt2, pt3 };
-                        polylines(zoomed, triangle, true, Scalar(255, 0, 255), 2);  // Pink triangle (BGR)
-                    }
-                }
-                else {
-                    cout << "\n[AZIMUTH] No picks aligned with azimuth at frame " << timestamp_sec << "s.\n";
-                    outFile << "\n[AZIMUTH] No picks aligned with azimuth at frame " << timestamp_sec << "s.\n";
-                }
+// Parse a "from:to:step" range ("0:40:5"; "from:to" uses step 1)
+SweepRange parseRange(const string& text) {
+    SweepRange range;
+    size_t first = text.find(':');
+    if (first == string::npos) throw invalid_argument(text);
+    size_t second = text.find(':', first + 1);
+    range.from = stoi(text.substr(0, first));
+    range.to = stoi(text.substr(first + 1, second == string::npos ? string::npos : second - first - 1));
+    if (second != string::npos) range.step = stoi(text.substr(second + 1));
+    return range;
+}
 
+void printUsage() {
+    cout << "Usage:" << endl;
+    cout << "  code [pipeline options]               interactive player (video selection menu)" << endl;
+    cout << "  code --batch <video> [options]        headless analysis without windows" << endl;
+    cout << "  code --batch-dir <folder> [options]   headless analysis of every video in a folder, in parallel" << endl;
+    cout << "  code --sweep <video> [options]        rank brightness / threshold settings from one decode of the video" << endl;
+    cout << "  code --stream <-|pipe|shm:name> [options]  play raw frames of a capture process (with --every: headless)" << endl;
+    cout << "Batch options:" << endl;
+    cout << "  --at <s1,s2,...>      analyze the frames at these timestamps (seconds)" << endl;
+    cout << "  --every <N>           analyze every N-th frame" << endl;
+    cout << "  --brightness <0-100>  brightness offset (default 11)" << endl;
+    cout << "  --threshold <0-255>   binary threshold (default 101)" << endl;
+    cout << "  --chunks <N>          --batch: split the video into N time ranges decoded in parallel (0 = one per core)" << endl;
+    cout << "Sweep options:" << endl;
+    cout << "  --sweep-brightness <from:to:step>  brightness values to try (default 0:40:5)" << endl;
+    cout << "  --sweep-threshold <from:to:step>   threshold values to try (default 60:200:5)" << endl;
+    cout << "  --sweep-frames <N>    only sweep over the first N frames (default: whole video)" << endl;
+    cout << "Stream options:" << endl;
+    cout << "  --stream-size <WxH>   headerless frames of this size (ffmpeg -f rawvideo; default: a header per frame)" << endl;
+    cout << "  --stream-format <gray|bgr>  pixel format of headerless frames (default bgr)" << endl;
+    cout << "  --stream-fps <N>      frame rate of headerless frames, for their timestamps (default 30)" << endl;
+    cout << "Pipeline options (both modes):" << endl;
+    cout << "  --workers <N>         analysis worker threads (default: cores - 2)" << endl;
+    cout << "  --queue <N>           frame slots per worker queue (default 3)" << endl;
+    cout << "  --drop-decode         drop decoded frames when the workers are full instead of waiting" << endl;
+    cout << "  --late <none|display|analysis>  interactive: frames behind their timestamp are not displayed (default display),"
+         << " also analyzed sparsely (analysis) or shown anyway (none)" << endl;
+    cout << "  --drop-late           same as --late display (kept for older scripts)" << endl;
+    cout << "  --display-fps <N>     interactive: displayed frames per second at most (default 30, 0 = all)" << endl;
+    cout << "  --preview-width <N>   interactive: display width of wider frames (default 1280, 0 = native)" << endl;
+    cout << "  --luma                decode only the Y plane of the video (no BGR conversion; displayed frames are converted)" << endl;
+    cout << "  --monitor-every <N>   interactive: analyze only every N-th frame once the contour converged (default 8, 1 = off)" << endl;
+    cout << "  --gray-cache-mb <N>   interactive: memory for the gray frames a trackbar change is recomputed from (default 256, 0 = off)" << endl;
+    cout << "  --gray-cache-scale <N>  interactive: cache 2x2 max-pooled frames with 2 (default 1 = native)" << endl;
+    cout << "  --baseline-every <K>  detect the baseline only every K-th frame once it is stable (default 1)" << endl;
+    cout << "  --pyramid <N>         search the baseline and picks on pyramid level N (1 = half size, max 3) and refine"
+         << " them at full resolution (default 0 = off)" << endl;
+    cout << "  --pyramid-tolerance <N>  full-resolution rows refined beyond the coarse estimate (default 2)" << endl;
+    cout << "  --no-roi              player / stream: process whole frames instead of the drum region learned over the first rotation"
+         << " (batch always processes whole frames)" << endl;
+    cout << "  --roi-refresh <N>     frames between two re-learnings of the drum region (default 9000, 0 = never)" << endl;
+    cout << "  --roi-probe <N>       process every N-th frame whole, a pick outside the drum region re-learns it"
+         << " (default 300, 0 = never: such a pick waits for --roi-refresh)" << endl;
+    cout << "  --track               follow every pick's tip at azimuth on every frame -> <base>_picks.csv" << endl;
+    cout << "  --track-tolerance <N> frames a pick's passage may drift within the drum turn (default 3)" << endl;
+    cout << "  --telemetry <file>    write stage latency / frame counter statistics (.json = JSON lines, else CSV)" << endl;
+    cout << "  --telemetry-interval <s>  statistics interval in seconds (default 2)" << endl;
+    cout << "  --hud                 interactive: show the stage statistics on the video ('h' toggles)" << endl;
+    cout << "Output options (both modes):" << endl;
+    cout << "  --format <png|jpg|webp|svg>  annotated frame format (default png; svg = native frame + SVG overlay)" << endl;
+    cout << "  --quality <N>         PNG compression 0-9, JPEG quality 0-100, WebP quality 1-100 (>100 = lossless, default)" << endl;
+    cout << "  --raster-scale <N>    upsampling of the annotated frame (default 4 = measurement units, 1 = native)" << endl;
+    cout << "  --svg                 same as --format svg" << endl;
+    cout << "  --export-threads <N>  background image encoder threads (default 2)" << endl;
+    cout << "  --export-queue <N>    images queued for encoding at most (default 16)" << endl;
+}
 
-                // ------- PRELIMINARY CONTOUR + PICK AZIMUTH MATCHING END ------- //
 
+int main(int argc, char** argv) {
+    // ------- COMMAND LINE ------- //
+    BatchOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--batch" && hasValue) options.videoPath = argv[++i];
+            else if (arg == "--at" && hasValue) options.analyzeAtSec = parseSecondsList(argv[++i]);
+            else if (arg == "--every" && hasValue) options.analyzeEveryN = stoi(argv[++i]);
+            else if (arg == "--batch-dir" && hasValue) options.videoDir = argv[++i];
+            else if (arg == "--brightness" && hasValue) options.brightness = stoi(argv[++i]);
+            else if (arg == "--threshold" && hasValue) options.threshold = stoi(argv[++i]);
+            else if (arg == "--sweep" && hasValue) options.sweep.videoPath = argv[++i];
+            else if (arg == "--sweep-brightness" && hasValue) options.sweep.brightness = parseRange(argv[++i]);
+            else if (arg == "--sweep-threshold" && hasValue) options.sweep.threshold = parseRange(argv[++i]);
+            else if (arg == "--sweep-frames" && hasValue) options.sweep.maxFrames = stoll(argv[++i]);
+            else if (arg == "--stream" && hasValue) options.stream.source = argv[++i];
+            else if (arg == "--stream-size" && hasValue) options.stream.rawSize = parseSize(argv[++i]);
+            else if (arg == "--stream-format" && hasValue && parseStreamFormat(argv[i + 1], options.stream.rawFormat)) ++i;
+            else if (arg == "--stream-fps" && hasValue) options.stream.rawFps = stod(argv[++i]);
+            else if (arg == "--chunks" && hasValue) options.chunks = stoi(argv[++i]);
+            else if (arg == "--workers" && hasValue) options.pipeline.workers = stoi(argv[++i]);
+            else if (arg == "--queue" && hasValue) options.pipeline.ringCapacity = stoi(argv[++i]);
+            else if (arg == "--drop-decode") options.pipeline.policy = BackpressurePolicy::DropNewest;
+            else if (arg == "--drop-late") options.playback.policy = LatePolicy::Display;
+            else if (arg == "--late" && hasValue && parseLatePolicy(argv[i + 1], options.playback.policy)) ++i;
+            else if (arg == "--display-fps" && hasValue) options.playback.maxDisplayFps = stod(argv[++i]);
+            else if (arg == "--preview-width" && hasValue) options.playback.previewWidth = stoi(argv[++i]);
+            else if (arg == "--luma") options.pipeline.lumaDecode = options.sweep.lumaDecode = true;
+            else if (arg == "--monitor-every" && hasValue) options.convergence.monitorEvery = stoi(argv[++i]);
+            else if (arg == "--gray-cache-mb" && hasValue) options.grayCache.budgetMB = stoi(argv[++i]);
+            else if (arg == "--gray-cache-scale" && hasValue) options.grayCache.downsample = stoi(argv[++i]);
+            else if (arg == "--svg") options.output.image.format = ExportFormat::Svg;
+            else if (arg == "--format" && hasValue && ExportQueue::parseFormat(argv[i + 1], options.output.image.format)) ++i;
+            else if (arg == "--quality" && hasValue) options.output.image.quality = stoi(argv[++i]);
+            else if (arg == "--raster-scale" && hasValue) options.output.image.rasterScale = stoi(argv[++i]);
+            else if (arg == "--export-threads" && hasValue) options.output.image.threads = stoi(argv[++i]);
+            else if (arg == "--export-queue" && hasValue) options.output.image.capacity = stoi(argv[++i]);
+            else if (arg == "--baseline-every" && hasValue) options.pipeline.baseline.everyK = stoi(argv[++i]);
+            else if (arg == "--track") options.tracking.enabled = true;
+            else if (arg == "--pyramid" && hasValue) options.pipeline.pyramid.levels = stoi(argv[++i]);
+            else if (arg == "--pyramid-tolerance" && hasValue) options.pipeline.pyramid.tolerance = stoi(argv[++i]);
+            else if (arg == "--no-roi") options.roi.enabled = false;
+            else if (arg == "--roi-refresh" && hasValue) options.roi.refreshEvery = stoll(argv[++i]);
+            else if (arg == "--roi-probe" && hasValue) options.roi.probeEvery = stoi(argv[++i]);
+            else if (arg == "--track-tolerance" && hasValue) options.tracking.phaseTolerance = stoi(argv[++i]);
+            else if (arg == "--telemetry" && hasValue) options.telemetryPath = argv[++i];
+            else if (arg == "--telemetry-interval" && hasValue) options.telemetryInterval = stod(argv[++i]);
+            else if (arg == "--hud") options.hud = true;
+            else {
+                printUsage();
+                return arg == "--help" ? 0 : -1;
             }
         }
+    }
+    catch (const std::exception&) {
+        cerr << "Error: Invalid numeric argument." << endl;
+        printUsage();
+        return -1;
+    }
 
-        // Process green pixels once: convert to blue or restore (azimuth contour graphic corrections)
-        for (int y = 0; y < zoomed.rows; ++y) {
-            for (int x = 0; x < zoomed.cols; ++x) {
-                Vec3b& pixel = zoomed.at<Vec3b>(y, x);
-                if (pixel == Vec3b(0, 255, 0)) {
-                    bool inYrange = (y > zoomed.rows * 0.1 && y < fixedBaselineY * 4);
-                    bool inXrange = (x >= 5 && x <= zoomed.cols - 8);
-                    if (inYrange && inXrange) {
-                        pixel = Vec3b(255, 0, 0);  // blue 
-                    }
-                    else {
-                        pixel = originalZoomed.at<Vec3b>(y, x);  // restore
-                    }
-                }
-            }
+    // ------- TELEMETRY ------- //
+    Telemetry stageTelemetry;
+    Telemetry* telemetry = nullptr;
+    if (!options.telemetryPath.empty() || options.hud) {
+        telemetry = &stageTelemetry;
+        options.output.telemetry = telemetry;
+        telemetry->setInterval(options.telemetryInterval);
+        options.pipeline.telemetry = telemetry;
+        if (!options.telemetryPath.empty() && !telemetry->openExport(options.telemetryPath)) {
+            cerr << "Error: Cannot write telemetry file " << options.telemetryPath << endl;
+            return -1;
         }
+    }
 
-        // Add label for azimuth contour line
-        putText(zoomed, "Azimuth Contour Line", Point(10, 100), FONT_HERSHEY_SIMPLEX, 0.9, Scalar(255, 0, 0), 2);
-
-
-        // ------- AZIMUTH CONTOUR BUILD END ------- //
-
-        // ------- CUTTING LINE STARTS ------- //
-
-        // Step 1: Extract sorted x-values from red circles
-        vector<int> xValues;
-        for (const auto& pt : recordedRedCircles) {
-            xValues.push_back(pt.x);
-        }
-        sort(xValues.begin(), xValues.end());
+    // ------- IMAGE EXPORT ------- //
+    // Annotated frames are encoded on background threads; declared before everything that submits to it
+    ExportQueue exporter(options.output.image);
+    options.output.exporter = &exporter;
+
+    // ------- PARAMETER SWEEP ------- //
+    if (!options.sweep.videoPath.empty()) {
+        createOutputFolder();
+        options.sweep.csvPath = options.output.folder + "/" + videoBaseName(options.sweep.videoPath) + "_sweep.csv";
+        SweepResult sweep = ParameterSweep::run(options.sweep, options.brightness, cout);
+        if (telemetry) telemetry->tick(true);
+        return sweep.frames > 0 ? 0 : -1;
+    }
 
-        // Step 2: Compute adjacent spacings
-        vector<int> spacings;
-        for (size_t i = 1; i < xValues.size(); ++i) {
-            spacings.push_back(xValues[i] - xValues[i - 1]);
+    // ------- HEADLESS STREAM MODE ------- //
+    if (!options.stream.source.empty() && (options.analyzeEveryN > 0 || !options.analyzeAtSec.empty())) {
+        if (!options.analyzeAtSec.empty()) {
+            cerr << "Error: --at needs a video file; analyze a stream with --every." << endl;
+            return -1;
         }
 
-        // Step 3: Compute Median
-        vector<int> sortedSpacings = spacings;
-        sort(sortedSpacings.begin(), sortedSpacings.end());
-        int median;
-        size_t n = sortedSpacings.size();
-        if (n % 2 == 0)
-            median = (sortedSpacings[n / 2 - 1] + sortedSpacings[n / 2]) / 2;
-        else
-            median = sortedSpacings[n / 2];
-
-        // Step 4: Compute MAD (Median Absolute Deviation)
-        vector<int> absDeviations;
-        for (int s : spacings) {
-            absDeviations.push_back(abs(s - median));
+        StreamSource source(options.stream);
+        if (!source.isOpen()) {
+            cerr << "Error: Cannot open frame stream: " << source.error() << endl;
+            return -1;
         }
-        sort(absDeviations.begin(), absDeviations.end());
-        int mad;
-        n = absDeviations.size();
-        if (n % 2 == 0)
-            mad = (absDeviations[n / 2 - 1] + absDeviations[n / 2]) / 2;
-        else
-            mad = absDeviations[n / 2];
-
-        // Step 5: Filter spacings using MAD threshold
-        vector<int> filteredSpacings;
-        int threshold = 2 * mad;
-        for (int s : spacings) {
-            if (abs(s - median) <= threshold) {
-                filteredSpacings.push_back(s);
-            }
+        createOutputFolder();
+        AnalysisSession session(StreamSource::baseName(options.stream.source), options.output);
+        int status = session.runStream(options, source, cout);
+        exporter.drain();
+        if (exporter.failures() > 0) {
+            cerr << "Error: " << exporter.failures() << " image(s) could not be written." << endl;
+            status = -1;
         }
+        if (telemetry) telemetry->tick(true);
+        return status;
+    }
 
-        // Step 6: Compute average spacing from filtered values
-        int sum = accumulate(filteredSpacings.begin(), filteredSpacings.end(), 0);
-        int averageSpacing = filteredSpacings.empty() ? 0 : sum / filteredSpacings.size();
-
-        cout << "\nFiltered Spacings: ";
-        for (int s : filteredSpacings) cout << s << " ";
-        cout << "\nEstimated Cutting Line Distance: " << averageSpacing << " px\n";
-        outFile << "\nEstimated Cutting Line Distance: " << averageSpacing << " px\n";
-
-        // Step 7: Draw vertical cutting lines using averageSpacing, anchored at median red circle
-        if (xValues.size() >= 2 && averageSpacing > 0) {
-            // Use the x-coordinate of the median red point as anchor
-            int xStart = xValues[xValues.size() / 2];
-
-            // Draw vertical dashed lines to the left of the anchor
-            for (int x = xStart - averageSpacing; x >= 0; x -= averageSpacing) {
-                drawDashedLine(zoomed, Point(x, 0), Point(x, zoomed.rows), Scalar(200, 200, 0));  // Yellow dashed line
-                putText(zoomed, to_string(x), Point(x + 2, 20), FONT_HERSHEY_PLAIN, 0.8, Scalar(200, 200, 0), 1);
-            }
-
-            // Draw vertical dashed lines to the right of the anchor (including anchor itself)
-            for (int x = xStart; x < zoomed.cols; x += averageSpacing) {
-                drawDashedLine(zoomed, Point(x, 0), Point(x, zoomed.rows), Scalar(200, 200, 0));  // Yellow dashed line
-                putText(zoomed, to_string(x), Point(x + 2, 20), FONT_HERSHEY_PLAIN, 0.8, Scalar(200, 200, 0), 1);
-            }
-
-            // Cutting lines now divide the frame at regular horizontal intervals
+    // ------- HEADLESS BATCH MODE ------- //
+    if (!options.videoPath.empty() || !options.videoDir.empty()) {
+        if (options.analyzeAtSec.empty() && options.analyzeEveryN <= 0) {
+            cerr << "Error: --batch needs --at or --every." << endl;
+            return -1;
         }
 
-
-        // ----- CUTTING LINE ENDS ------- //
-
-
-        // ------- BASE LINE PLOT START ------- //
-
-        // If the fixed baseline was detected earlier, draw it
-        if (fixedBaselineY != -1) {
-            int zoomedBaselineY = fixedBaselineY * 4; // Scale the baseline for zoomed image
-
-            line(zoomed, Point(0, zoomedBaselineY), Point(zoomed.cols, zoomedBaselineY), Scalar(0, 255, 255), 5); // Draw yellow baseline    
-            string label = "Baseline: " + to_string(zoomed.rows - zoomedBaselineY) + " px from bottom";
-            putText(zoomed, label, Point(10, zoomedBaselineY - 10), FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 255), 2);
-
-            //cout << "Using fixed baseline at y = " << fixedBaselineY << " (zoomed y = " << zoomedBaselineY << ")" << endl;
+        createOutputFolder();
+        int status;
+        if (!options.videoDir.empty()) {
+            status = runBatchFolder(options);
         }
         else {
-            cout << "Baseline not available!" << endl;
+            AnalysisSession session(options.videoPath, options.output);
+            status = session.runBatch(options, cout);
         }
-
-        // ------- BASE LINE PLOT END ------- //
-
-        // Show the zoomed image in a new window
-        imshow("Resampled Frame", zoomed);
-
-        // Save the zoomed image to disk with timestamp - PNG version
-        imwrite(filename, zoomed);
-        cout << "\nSaved resampled frame as: " << filename << endl;
-
-		//// Save the zoomed image to disk with timestamp - EPS conversion
-        //imwrite(filename, zoomed);
-        //string epsCommand = "magick \"" + filename + "\" -density 96 eps:\"" + filename.substr(0, filename.size() - 4) + ".eps\"";
-        //system(epsCommand.c_str());
-        //// Delete the original PNG file
-        //remove(filename.c_str());
-        //
-        //cout << "\nSaved resampled frame at: Outputs/" << baseName << "_" + to_string(timestamp_sec) + "s.eps" << endl;
-
+        exporter.drain();
+        if (exporter.failures() > 0) {
+            cerr << "Error: " << exporter.failures() << " image(s) could not be written." << endl;
+            status = -1;
+        }
+        if (telemetry) telemetry->tick(true);
+        return status;
+    }
+    else if (!options.analyzeAtSec.empty() || options.analyzeEveryN > 0) {
+        cerr << "Error: --at and --every need --batch <video> or --batch-dir <folder>." << endl;
+        return -1;
     }
-}
-
 
-int main() {
     // Set the path to the video file
     //string path = "Resources/video_0.mp4";
 
     // Create Output folder
-	system("mkdir Outputs >nul 2>&1"); // null suppresses output, 2>&1 redirects error to null
-
-    // Ask user to select a video
-    cout << "\nSelect a video to play:" << endl;
-    cout << "0. video_0.mp4 (suggested tuning- brightness: 11 bin threshold: 101)" << endl;
-    cout << "1. video_1.mp4 (suggested tuning- brightness: 11 bin threshold: 101)" << endl;
-    cout << "2. video_2.mp4 (suggested tuning- brightness: 20 bin threshold: 80)" << endl;
-    cout << "\nEnter your choice 0-2 (Default: 0): " << endl;
+    createOutputFolder();
 
+    // A frame stream replaces the video selection (stdin may be the stream itself)
+    bool streaming = !options.stream.source.empty();
+    string path = streaming ? StreamSource::baseName(options.stream.source) : string();
 
-    int choice;
-    cin >> choice;
+    // Ask user to select a video
+    int choice = -1;
+    if (!streaming) {
+        cout << "\nSelect a video to play:" << endl;
+        cout << "0. video_0.mp4 (suggested tuning- brightness: 11 bin threshold: 101)" << endl;
+        cout << "1. video_1.mp4 (suggested tuning- brightness: 11 bin threshold: 101)" << endl;
+        cout << "2. video_2.mp4 (suggested tuning- brightness: 20 bin threshold: 80)" << endl;
+        cout << "\nEnter your choice 0-2 (Default: 0): " << endl;
+        cin >> choice;
+    }
 
-    string path;
     switch (choice) {
     case 0:
         path = "Resources/video_0.mp4";
@@ -496,22 +424,52 @@ int main() {
         path = "Resources/video_2.mp4";
         break;
     default:
+        if (streaming) break;
         cout << "Invalid choice. Using default video_0.mp4." << endl;
         path = "Resources/video_0.mp4";
     }
 
-    // Extract the video base name for output naming
-    size_t lastSlash = path.find_last_of("/\\");
-    string fileOnly = path.substr(lastSlash + 1);
-    size_t dotPos = fileOnly.find_last_of('.');
-    baseName = fileOnly.substr(0, dotPos);  // "video_0"
-
-    // Open the video file
-    VideoCapture cap(path);
-    if (!cap.isOpened()) {
-        cerr << "Error: Cannot open video file." << endl;
-        return -1;
+    // Session of the played video (its base name, e.g. "video_0", names the output files)
+    AnalysisSession session(path, options.output);
+    session.brightnessValue = options.brightness;
+    session.thresholdValue = options.threshold;
+    if (options.tracking.enabled) {
+        options.convergence.monitorEvery = 1;   // The tracker needs every frame analyzed
+        if (options.playback.policy == LatePolicy::Analysis) options.playback.policy = LatePolicy::Display;
+    }
+    session.convergence = ConvergenceMonitor(options.convergence);
+    session.grayCache = GrayFrameCache(options.grayCache);
+    session.tracker = PickTracker(options.tracking);
+    session.drumRoi = DrumRoi(options.roi);
+
+    // Open the video file, or the frame stream (played once, as fast as the producer delivers)
+    VideoCapture cap;
+    unique_ptr<StreamSource> stream;
+    unique_ptr<FrameSource> video;
+    double fps = 0;
+    if (streaming) {
+        stream.reset(new StreamSource(options.stream));
+        if (!stream->isOpen()) {
+            cerr << "Error: Cannot open frame stream: " << stream->error() << endl;
+            return -1;
+        }
+        options.pipeline.loopVideo = false;
+        if (options.stream.rawSize.area() > 0) fps = options.stream.rawFps;
     }
+    else {
+        cap.open(path);
+        if (!cap.isOpened()) {
+            cerr << "Error: Cannot open video file." << endl;
+            return -1;
+        }
+        video.reset(new VideoFileSource(cap, options.pipeline.lumaDecode));
+        fps = cap.get(CAP_PROP_FPS);
+    }
+    FrameSource& source = streaming ? static_cast<FrameSource&>(*stream) : *video;
+
+    // Frame budget of the stage telemetry: the source frame interval
+    if (telemetry && fps > 0) telemetry->setFrameBudgetMs(1000.0 / fps);
+    bool showHud = options.hud;
 
     // Create a resizable window for video playback
     namedWindow("Cutting Drum Video", WINDOW_NORMAL);
@@ -520,136 +478,181 @@ int main() {
     int prevWinWidth = -1, prevWinHeight = -1;
 
 
-    // Assign the mouse click handler and pass the capture object (if needed in future)
-    setMouseCallback("Cutting Drum Video", onMouse);
+    // Assign the mouse click handler and pass the queue its analyses run on
+    ClickQueue clicks;
+    clicks.session = &session;
+    setMouseCallback("Cutting Drum Video", onMouse, &clicks);
 
     // Create a window for controlling contour detection
     namedWindow("Contour Adjustment Panel", WINDOW_NORMAL);
     resizeWindow("Contour Adjustment Panel", 500, 100);
-    createTrackbar("Brightness", "Contour Adjustment Panel", &brightnessValue, 100);        // Range: 0-100
-    createTrackbar("Bin Thresh", "Contour Adjustment Panel", &thresholdValue, 255);         // Range: 0-255
+    createTrackbar("Brightness", "Contour Adjustment Panel", &session.brightnessValue, 100);        // Range: 0-100
+    createTrackbar("Bin Thresh", "Contour Adjustment Panel", &session.thresholdValue, 255);         // Range: 0-255
+
+    // Decoding and per-frame analysis run on the pipeline threads, this loop merges and displays
+    FramePipeline pipeline(source, options.pipeline);
+    pipeline.setParameters(session.brightnessValue, session.thresholdValue);
+    pipeline.start();
+
+    // Per-frame buffers (packets, gray cache, outline, click frame) are sized during the warm-up, which
+    // also covers the rotation period search; afterwards consuming a frame must not allocate
+    AllocationCheck allocations(2LL * options.convergence.maxPeriod);
+    vector<vector<Point>> liveOutline;
+    Mat displayFrame;   // BGR copy of gray stream frames and of frames in the producer's memory
+    Mat previewFrame;   // Displayed frame scaled down to the preview width
+
+    // Real-time pacing from the frame timestamps (a stream is shown as fast as the producer delivers)
+    options.playback.paced = !streaming;
+    options.playback.telemetry = telemetry;
+    PlaybackScheduler scheduler(options.playback, fps);
+
+    // Analysis cadence: the converged monitoring cadence, or sparser while the player is behind (--late analysis)
+    int analysisCadence = 1;
+    auto applyCadence = [&]() {
+        int cadence = max(session.convergence.cadence(), scheduler.analysisCadence());
+        if (cadence != analysisCadence) pipeline.setAnalysisCadence(cadence);
+        analysisCadence = cadence;
+    };
 
     // Main video display loop
     bool windowIsOpen = true;
     while (windowIsOpen) {
-        Mat frame;
-
-        // Read a frame from the video
-        if (!cap.read(frame)) {
-            // If we reached the end of the video, loop back to the start
-            cap.set(CAP_PROP_POS_FRAMES, 0);
-            continue;
+        // Next analyzed frame in decode order (the decoder loops back to the start at the end)
+        FramePacket* packet;
+        {
+            ScopedTimer timer(telemetry, Stage::Wait);
+            packet = pipeline.next();
         }
+        if (!packet) break;
+        bool showFrame = scheduler.beginFrame(packet->index, packet->timestampMs);
+        applyCadence();
 
-        // Clone the current frame for use in the mouse callback
-        currentFrame = frame.clone();
-        currentTimestamp = cap.get(CAP_PROP_POS_MSEC); // Get timestamp in milliseconds
+        // The overlays are drawn on the frame: only on its own BGR buffer, never on a stream ring slot
+        bool ownBgrFrame = packet->frame.channels() == 3 && packet->frame.u;
+        if (packet->frame.channels() == 1) cvtColor(packet->frame, displayFrame, COLOR_GRAY2BGR);
+        else if (!ownBgrFrame) packet->frame.copyTo(displayFrame);
+        Mat& frame = ownBgrFrame ? packet->frame : displayFrame;
+        auto frameStart = chrono::steady_clock::now();
+        allocations.beginFrame();
 
-        // ------- USER CHANGE TRACKER ------- //
-        if (brightnessValue != prevBrightnessValue || thresholdValue != prevThresholdValue) {
-            accumulatedBinary.release();  // Properly clears the matrix memory
-            isFirstBinary = true;         // Reset the flag so next binary becomes the base
+        // Clean copy of the frame for use in the mouse callback (timestamp in milliseconds)
+        if (!session.setCurrentFrame(frame, packet->timestampMs)) allocations.skipFrame();
 
-            cout << "Trackbar values changed -> clearing accumulated binary mask." << endl;
+        // ------- USER CHANGE TRACKER ------- //
+        if (session.brightnessValue != session.prevBrightnessValue || session.thresholdValue != session.prevThresholdValue) {
+            allocations.skipFrame();              // Rebuild and console output: an event, not the steady state
+            session.convergence.reset();          // Analyzed at full rate until it converges again
+            applyCadence();
+            pipeline.setParameters(session.brightnessValue, session.thresholdValue);
+
+            // Fresh azimuth outline with the new values, rebuilt from the cached gray frames of the last rotation
+            auto rebuildStart = chrono::steady_clock::now();
+            int cachedFrames = session.rebuildEnvelope();
+            if (cachedFrames > 0) {
+                cout << "Trackbar values changed -> azimuth contour rebuilt from " << cachedFrames << " cached frames in "
+                     << chrono::duration<double, milli>(chrono::steady_clock::now() - rebuildStart).count() << " ms." << endl;
+            }
+            else {
+                cout << "Trackbar values changed -> clearing accumulated azimuth contour." << endl;
+            }
 
-            prevBrightnessValue = brightnessValue;
-            prevThresholdValue = thresholdValue;
+            session.prevBrightnessValue = session.brightnessValue;
+            session.prevThresholdValue = session.thresholdValue;
         }
 
-
-        // ------- BASELINE DETECTION PER FRAME ------- //
-
-        // Convert current frame to grayscale and apply Gaussian blur
-        Mat gray;
-        cvtColor(frame, gray, COLOR_BGR2GRAY);
-        GaussianBlur(gray, gray, Size(5, 5), 2);
-
-        // Detect horizontal transitions using vertical gradient
-        Mat gradY;
-        Sobel(gray, gradY, CV_32F, 0, 1, 3); // 0,1 is derivative order; 0 in X (no horizontal), 1 in Y (vertical), so it detects horzontal edges, 3 is kernel standard in Sobel
-
-        // Sum vertical edge strength per row
-        Mat rowEnergy;
-        reduce(abs(gradY), rowEnergy, 1, REDUCE_SUM, CV_32F); //sum absolute gradient value of every row, reduced to 1-column matrix rowEnergy
-
-        // Only scan from middle to near bottom of image
-        int startY = gray.rows / 2; // Mid-point
-        int endY = gray.rows * 9 / 10; // 90% of the image height towards bottom
-
-        float maxEnergy = 0;
-        int detectedY = -1;
-
-        // Loop over rows to find the strongest horizontal edge
-        for (int y = startY; y < endY; ++y) {
-            float energy = rowEnergy.at<float>(y);
-            if (energy > maxEnergy) {
-                maxEnergy = energy;
-                detectedY = y;
+        // ------- BASELINE + AZIMUTH ACCUMULATION (in decode order) ------- //
+        {
+            ScopedTimer timer(telemetry, Stage::Merge);
+            size_t cacheSlots = session.grayCache.slots();
+            long long trackerEvents = session.tracker.events();
+            Rect roi = session.drumRoi.region();
+            if (packet->analyzed && (packet->brightness != session.brightnessValue || packet->threshold != session.thresholdValue)) {
+                allocations.skipFrame();          // Analyzed with the old trackbar values: re-masked below
+            }
+            int changedColumns = session.consumePacket(*packet);
+            if (session.grayCache.slots() != cacheSlots) allocations.skipFrame();   // Gray cache still filling
+            if (session.tracker.events() != trackerEvents) allocations.skipFrame();   // New lane or pick
+            pipeline.publishBaseline(session.fixedBaselineY, session.baselineStability.stable());
+            if (session.drumRoi.region() != roi) {
+                allocations.skipFrame();
+                pipeline.publishRoi(session.drumRoi.region(), session.drumRoi.probeEvery());
+                if (session.drumRoi.region().empty()) {
+                    cout << "Drum region -> learning it again on whole frames." << endl;
+                }
+                else {
+                    cout << "Drum region learned: " << session.drumRoi.region().width << "x" << session.drumRoi.region().height
+                         << " (" << static_cast<int>(100 * session.drumRoi.coverage(packet->frame.size())) << "% of the frame)." << endl;
+                }
             }
-        }
 
-        // If this baseline is higher (closer to top) than previous, update it
-        if (detectedY != -1 && (fixedBaselineY == -1 || detectedY < fixedBaselineY)) {
-            fixedBaselineY = detectedY + 2.25;
-            //cout << "Updated fixed baselineY to: " << fixedBaselineY << endl;
+            // Converged envelope: analyze a sparse sample only, back to full rate on any change
+            if (packet->analyzed &&
+                session.convergence.observe(packet->index, packet->binary, changedColumns, session.fixedBaselineY)) {
+                applyCadence();
+                allocations.skipFrame();
+                if (session.convergence.converged()) {
+                    cout << "Azimuth contour converged after " << session.convergence.framesToConverge() << " frames (rotation period "
+                         << (session.convergence.rotationPeriod() > 0 ? to_string(session.convergence.rotationPeriod()) + " frames" : "unknown")
+                         << ") -> analyzing every " << session.convergence.cadence() << ". frame." << endl;
+                }
+                else {
+                    cout << "Azimuth contour or baseline changed -> analyzing every frame again." << endl;
+                }
+            }
         }
 
-        // ------- CONTOUR DETECTION PER FRAME ------- //
-
-        // Apply brightness by adding a scalar value
-        Mat brightGray;
-        add(gray, Scalar(brightnessValue), brightGray);  // Add brightness from trackbar
+        session.azimuthEnvelope.outline(liveOutline);
+        allocations.endFrame();   // Drawing and the GUI below allocate inside OpenCV / HighGUI
 
-        // Apply binary thresholding with dynamic value
-        Mat binary;
-        threshold(brightGray, binary, thresholdValue, 255, THRESH_BINARY);
+        auto displayStart = chrono::steady_clock::now();
 
-        // Mask out top 10% of the image
-        int ignoreTop = static_cast<int>(0.1 * binary.rows);
-        binary.rowRange(0, ignoreTop).setTo(0);
-
-        // Mask out everything below baseline (if baseline is available)
-        if (fixedBaselineY != -1) {
-            binary.rowRange(static_cast<int>(fixedBaselineY), binary.rows).setTo(0);
-        }
+        // Late frames and frames above the display rate are accumulated only: no overlays, no imshow
+        Mat shown;
+        if (showFrame) {
+            // Draw the contours on the original frame (for real-time display)
+            drawContours(frame, packet->contours, -1, Scalar(0, 255, 0), 2);
 
+            // Live azimuth contour (blue): the envelope is cheap enough to draw on every frame
+            polylines(frame, liveOutline, false, Scalar(255, 0, 0), 1);
 
+            // Tracked tips at azimuth (magenta) with their pick id and height
+            const int zoom = AnalyzerParams().scale;
+            for (const auto& tip : session.tracker.currentTips()) {
+                Point position(tip.position.x / zoom, tip.position.y / zoom);
+                circle(frame, position, 4, Scalar(255, 0, 255), 2);
+                putText(frame, "#" + to_string(tip.pick) + " " + to_string(tip.height), position + Point(6, -6),
+                        FONT_HERSHEY_SIMPLEX, 0.4, Scalar(255, 0, 255), 1);
+            }
 
-        // --- FOR AZIMUTH CONTOUR: Accumulate binary masks across frames ---
-        if (isFirstBinary) {
-            accumulatedBinary = binary.clone();
-            isFirstBinary = false;
-        }
-        else {
-            bitwise_or(accumulatedBinary, binary, accumulatedBinary);
+            // Preview resolution for the window; clicks still analyze the full frame
+            Size preview = scheduler.previewSize(frame.size());
+            if (preview != frame.size()) {
+                resize(frame, previewFrame, preview, 0, 0, INTER_AREA);
+                shown = previewFrame;
+            }
+            else {
+                shown = frame;
+            }
+            if (telemetry && showHud) telemetry->drawHud(shown);
         }
-        // --- END OF AZIMUTH CONTOUR ACCUMULATION ---
-
-
-        // Find contours from the masked binary image
-        vector<vector<Point>> pickContours;
-        findContours(binary, pickContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-
-        // Draw the contours on the original frame (for real-time display)
-        drawContours(frame, pickContours, -1, Scalar(0, 255, 0), 2);
-
+        if (telemetry) telemetry->sampleQueueDepth(pipeline.readyCount());
 
         try {
             // Detect window resize
-            int winWidth = getWindowImageRect("Cutting Drum Video").width;
-            int winHeight = getWindowImageRect("Cutting Drum Video").height;
-
-            if (winWidth != prevWinWidth || winHeight != prevWinHeight) {
-                cout << "Window resized or moved. Resetting accumulated binary mask." << endl;
-                accumulatedBinary.release();
-                isFirstBinary = true;
-                prevWinWidth = winWidth;
-                prevWinHeight = winHeight;
+            Rect window = getWindowImageRect("Cutting Drum Video");
+            if (window.width != prevWinWidth || window.height != prevWinHeight) {
+                cout << "Window resized or moved -> rebuilding accumulated azimuth contour." << endl;
+                session.rebuildEnvelope();
+                session.convergence.reset();
+                applyCadence();
+                prevWinWidth = window.width;
+                prevWinHeight = window.height;
             }
 
             // Display the current frame in the window
-            imshow("Cutting Drum Video", frame);
+            if (showFrame) {
+                imshow("Cutting Drum Video", shown);
+            }
         }
         catch (const cv::Exception& e) {
             // Handle exceptions (e.g., if the window is closed unexpectedly)
@@ -657,9 +660,21 @@ int main() {
             break;
         }
 
-        // Wait for 30 milliseconds for a key press
-        int key = waitKey(30);
+        // Report click analyses that finished on the worker pool
+        collectClickResults(clicks);
+
+        // Consumer work of this frame, without the wait for it and the waitKey pacing below
+        if (telemetry) {
+            auto now = chrono::steady_clock::now();
+            telemetry->record(Stage::Display, now - displayStart);
+            telemetry->recordFrame(now - frameStart);
+            telemetry->tick();
+        }
+
+        // Wait for a key press until the next frame is due (just poll the GUI when behind; a stream sets its own pace)
+        int key = waitKey(scheduler.waitMs());
         if (key == 27) break;  // ESC key pressed -> exit the loop
+        if (key == 'h' && telemetry) showHud = !showHud;  // Toggle the telemetry HUD
 
         // Optional: additional check to see if window was manually closed (more robust)
         //double prop = -1;
@@ -673,16 +688,22 @@ int main() {
         try {
             int winVisible = (int)getWindowProperty("Cutting Drum Video", WND_PROP_VISIBLE);
             if (winVisible < 1) break;
-
-            imshow("Cutting Drum Video", frame);
         }
         catch (const cv::Exception& e) {
             cerr << "Window handling exception: " << e.what() << endl;
             break;
         }
 
+        // Hand the frame slot back to the decoder
+        pipeline.release();
     }
 
+    // Stop the pipeline threads before the capture they use is released
+    pipeline.stop();
+    if (telemetry) telemetry->tick(true);
+    if (stream && !stream->error().empty()) cerr << "Error: Frame stream: " << stream->error() << endl;
+    session.finishTracking(cout);
+
     // Clean up: release video capture and destroy all OpenCV windows
     cap.release();
     destroyAllWindows();
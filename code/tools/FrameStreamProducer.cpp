@@ -0,0 +1,85 @@
+// Frame stream producer: plays a video file into the raw frame stream of the analyzer, as a stand-in
+// for the capture process. Every frame goes out with its StreamFrameHeader, to stdout, a named pipe or
+// a shared-memory ring. Status goes to stderr, stdout may be the stream.
+//
+//   frame_stream_producer Resources/video_0.mp4 - | code --stream -
+//   frame_stream_producer Resources/video_0.mp4 shm:drum --slots 8 --realtime   (then: code --stream shm:drum)
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "StreamSource.h"
+
+using namespace cv;            // Use the cv namespace to simplify OpenCV code
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+void printUsage() {
+    cerr << "Usage: frame_stream_producer <video> <-|pipe|shm:name> [--slots N] [--gray] [--realtime]" << endl;
+    cerr << "  --slots     frames in the shared-memory ring (default 4)" << endl;
+    cerr << "  --gray      send gray frames instead of BGR" << endl;
+    cerr << "  --realtime  send at the frame rate of the video instead of as fast as the reader takes them" << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage();
+        return -1;
+    }
+    string videoPath = argv[1];
+    string target = argv[2];
+    int slots = 4;
+    bool gray = false;
+    bool realtime = false;
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--slots" && i + 1 < argc) slots = atoi(argv[++i]);
+        else if (arg == "--gray") gray = true;
+        else if (arg == "--realtime") realtime = true;
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);   // A reader that quits ends the writes, not the process
+#endif
+
+    VideoCapture cap(videoPath);
+    if (!cap.isOpened()) {
+        cerr << "Error: Cannot open video file " << videoPath << endl;
+        return -1;
+    }
+    StreamWriter writer;
+    if (!writer.open(target, slots)) {
+        cerr << "Error: Cannot open " << target << " for writing" << endl;
+        return -1;
+    }
+
+    double fps = cap.get(CAP_PROP_FPS);
+    auto frameInterval = chrono::duration<double>(fps > 0 ? 1.0 / fps : 0.0);
+    auto start = chrono::steady_clock::now();
+
+    Mat frame, grayFrame;
+    long long frames = 0;
+    while (cap.read(frame)) {
+        double timestampMs = cap.get(CAP_PROP_POS_MSEC);
+        if (gray) cvtColor(frame, grayFrame, COLOR_BGR2GRAY);
+        if (realtime) this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(frameInterval * frames));
+        if (!writer.write(gray ? grayFrame : frame, timestampMs)) {
+            cerr << "Reader gone or frame too large for the ring after " << frames << " frames" << endl;
+            break;
+        }
+        ++frames;
+    }
+    writer.close();
+    cerr << "Sent " << frames << " frames" << endl;
+    return 0;
+}
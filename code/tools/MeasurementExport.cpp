@@ -0,0 +1,131 @@
+// Measurement log export: converts a <video>_measurements.mlog into CSV, or into a wear trend of the
+// matched pick tip heights per time bucket. Reads the log through a memory mapping, so even logs of
+// multi-hour runs are exported without loading them.
+//
+//   measurement_export Outputs/video_0_measurements.mlog video_0.csv
+//   measurement_export Outputs/video_0_measurements.mlog --trend 60
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "MeasurementLog.h"
+
+using namespace std;           // Use the std namespace for standard library
+
+namespace {
+
+void printUsage() {
+    cout << "Usage: measurement_export <log.mlog> [out.csv] [--trend <seconds>]" << endl;
+    cout << "  default   one CSV row per azimuth pick / matched tip (frames without any: one empty row)" << endl;
+    cout << "  --trend   frames, tips, mean and minimum tip height per time bucket of the given length" << endl;
+}
+
+void exportRows(const MeasurementLogReader& log, ostream& out) {
+    out << "timestamp_ms,baseline_y,cutting_spacing,kind,x,height\n";
+    for (const auto& block : log.blocks()) {
+        size_t pick = 0, tip = 0;
+        for (size_t i = 0; i < block.frames; ++i) {
+            ostringstream prefix;
+            prefix << fixed << setprecision(3) << block.timestampMs[i] << "," << setprecision(2) << block.baselineY[i]
+                   << "," << block.cuttingSpacing[i] << ",";
+            const string frame = prefix.str();
+            if (block.pickCount[i] == 0 && block.tipCount[i] == 0) out << frame << ",,\n";
+            for (uint32_t k = 0; k < block.pickCount[i]; ++k, ++pick) {
+                out << frame << "azimuth," << block.pickX[pick] << "," << block.pickHeight[pick] << "\n";
+            }
+            for (uint32_t k = 0; k < block.tipCount[i]; ++k, ++tip) {
+                out << frame << "tip," << block.tipX[tip] << "," << block.tipHeight[tip] << "\n";
+            }
+        }
+    }
+}
+
+void exportTrend(const MeasurementLogReader& log, double bucketSec, ostream& out) {
+    struct Bucket {
+        long long frames = 0;
+        long long tips = 0;
+        double heightSum = 0.0;
+        int minHeight = 0;
+    };
+    vector<Bucket> buckets;
+
+    for (const auto& block : log.blocks()) {
+        size_t tip = 0;
+        for (size_t i = 0; i < block.frames; ++i) {
+            size_t index = static_cast<size_t>(max(0.0, block.timestampMs[i] / 1000.0 / bucketSec));
+            if (index >= buckets.size()) buckets.resize(index + 1);
+            Bucket& bucket = buckets[index];
+            ++bucket.frames;
+            for (uint32_t k = 0; k < block.tipCount[i]; ++k, ++tip) {
+                int height = block.tipHeight[tip];
+                bucket.minHeight = bucket.tips == 0 ? height : min(bucket.minHeight, height);
+                bucket.heightSum += height;
+                ++bucket.tips;
+            }
+        }
+    }
+
+    out << "bucket_start_s,frames,tips,mean_tip_height,min_tip_height\n" << fixed << setprecision(2);
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        const Bucket& bucket = buckets[i];
+        if (bucket.frames == 0) continue;
+        out << i * bucketSec << "," << bucket.frames << "," << bucket.tips << ",";
+        if (bucket.tips > 0) out << bucket.heightSum / bucket.tips << "," << bucket.minHeight;
+        else out << ",";
+        out << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    string logPath, csvPath;
+    double trendSec = 0.0;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--trend" && i + 1 < argc) trendSec = stod(argv[++i]);
+            else if (arg == "--help") { printUsage(); return 0; }
+            else if (logPath.empty()) logPath = arg;
+            else if (csvPath.empty()) csvPath = arg;
+            else { printUsage(); return -1; }
+        }
+    }
+    catch (const std::exception&) {
+        cerr << "Error: Invalid numeric argument." << endl;
+        return -1;
+    }
+    if (logPath.empty() || trendSec < 0) {
+        printUsage();
+        return -1;
+    }
+
+    MeasurementLogReader log;
+    if (!log.open(logPath)) {
+        cerr << "Error: " << logPath << " is not a readable measurement log." << endl;
+        return -1;
+    }
+    if (log.trailingBytes() > 0) {
+        cerr << "Warning: ignored " << log.trailingBytes() << " bytes of incomplete blocks." << endl;
+    }
+
+    ofstream csvFile;
+    if (!csvPath.empty()) {
+        csvFile.open(csvPath);
+        if (!csvFile) {
+            cerr << "Error: Cannot write " << csvPath << endl;
+            return -1;
+        }
+    }
+    ostream& out = csvPath.empty() ? cout : csvFile;
+
+    if (trendSec > 0) exportTrend(log, trendSec, out);
+    else exportRows(log, out);
+
+    cerr << log.frameCount() << " frames in " << log.blocks().size() << " blocks exported." << endl;
+    return 0;
+}